@@ -0,0 +1,335 @@
+#include "../source/pontella.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef PONTELLA_MMAP
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
+
+// GCC reports malloc and free in replacement allocation functions as mismatched once they are inlined.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+/// allocations and allocated_bytes count the calls to operator new, for every thread.
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> allocated_bytes(0);
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+/// peak_memory returns the maximum resident set size of the process in kilobytes, or zero if it is not available.
+/// The maximum never decreases, hence each scenario runs in its own process (see run_isolated).
+uint64_t peak_memory() {
+#ifdef PONTELLA_MMAP
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) < 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+/// scenario describes the labels and the command line of a benchmark.
+/// mix is one of "name_value" (--name=value), "alias_value" (-alias value), "positional" and "mixed".
+struct scenario {
+    std::size_t number_of_labels;
+    std::size_t aliases_per_label;
+    std::size_t number_of_tokens;
+    std::string mix;
+};
+
+/// fixture owns the labels and the command line generated for a scenario.
+struct fixture {
+    std::vector<pontella::label> options;
+    std::vector<pontella::label> flags;
+    std::vector<std::string> tokens;
+    std::vector<char*> argv;
+
+    fixture(const scenario& scenario) {
+        options.reserve(scenario.number_of_labels);
+        for (std::size_t index = 0; index < scenario.number_of_labels; ++index) {
+            std::unordered_set<std::string> aliases;
+            for (std::size_t alias_index = 0; alias_index < scenario.aliases_per_label; ++alias_index) {
+                aliases.insert("o" + std::to_string(index) + "a" + std::to_string(alias_index));
+            }
+            options.emplace_back("option" + std::to_string(index), aliases);
+        }
+        flags.emplace_back("help", std::unordered_set<std::string>{"h"});
+        tokens.reserve(scenario.number_of_tokens + 1);
+        tokens.push_back("./program");
+        for (std::size_t index = 0; tokens.size() <= scenario.number_of_tokens; ++index) {
+            auto kind = index % 3;
+            if (scenario.mix == "name_value") {
+                kind = 0;
+            } else if (scenario.mix == "alias_value") {
+                kind = 1;
+            } else if (scenario.mix == "positional") {
+                kind = 2;
+            }
+            const auto label_index = std::to_string(index % scenario.number_of_labels);
+            if (kind == 0) {
+                tokens.push_back("--option" + label_index + "=value" + std::to_string(index));
+            } else if (kind == 1 && tokens.size() < scenario.number_of_tokens) {
+                tokens.push_back(
+                    scenario.aliases_per_label == 0 ? "-option" + label_index : "-o" + label_index + "a0");
+                tokens.push_back("value" + std::to_string(index));
+            } else {
+                tokens.push_back("argument" + std::to_string(index));
+            }
+        }
+        argv.reserve(tokens.size());
+        for (auto& token : tokens) {
+            argv.push_back(&token[0]);
+        }
+    }
+
+    int argc() const {
+        return static_cast<int>(argv.size());
+    }
+};
+
+/// result contains the measurements of a benchmark.
+struct result {
+    std::string name;
+    scenario parameters;
+    std::size_t iterations;
+    uint64_t minimum_duration;
+    uint64_t median_duration;
+    double allocations_per_iteration;
+    double bytes_per_iteration;
+    uint64_t peak_memory;
+};
+
+/// sink prevents the compiler from removing the benchmarked calls.
+static volatile std::size_t sink = 0;
+
+/// measure calls run repeatedly for at least minimum_time (and at least once).
+/// run must return a value derived from its result, added to sink.
+template <typename Run>
+result measure(const std::string& name, const scenario& scenario, std::chrono::nanoseconds minimum_time, Run run) {
+    std::vector<uint64_t> durations;
+    durations.reserve(1000);
+    uint64_t total_allocations = 0;
+    uint64_t total_bytes = 0;
+    const auto measure_begin = std::chrono::steady_clock::now();
+    do {
+        const auto allocations_begin = allocations.load();
+        const auto bytes_begin = allocated_bytes.load();
+        const auto begin = std::chrono::steady_clock::now();
+        sink = sink + run();
+        const auto end = std::chrono::steady_clock::now();
+        total_allocations += allocations.load() - allocations_begin;
+        total_bytes += allocated_bytes.load() - bytes_begin;
+        durations.push_back(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+    } while (std::chrono::steady_clock::now() - measure_begin < minimum_time && durations.size() < 1000);
+    std::sort(durations.begin(), durations.end());
+    const auto iterations = static_cast<double>(durations.size());
+    return {name,
+            scenario,
+            durations.size(),
+            durations.front(),
+            durations[durations.size() / 2],
+            static_cast<double>(total_allocations) / iterations,
+            static_cast<double>(total_bytes) / iterations,
+            peak_memory()};
+}
+
+/// write_json writes the results as a JSON object with a "benchmarks" array.
+/// tokens_per_second is omitted for the "construct" measurements, which do not parse tokens.
+void write_json(std::ostream& stream, const std::vector<result>& results) {
+    stream << "{\n    \"benchmarks\": [";
+    for (std::size_t index = 0; index < results.size(); ++index) {
+        const auto& result = results[index];
+        stream << (index == 0 ? "\n" : ",\n") << "        {\"name\": \"" << result.name << "\", \"labels\": "
+               << result.parameters.number_of_labels << ", \"aliases\": " << result.parameters.aliases_per_label
+               << ", \"tokens\": " << result.parameters.number_of_tokens << ", \"mix\": \"" << result.parameters.mix
+               << "\", \"iterations\": " << result.iterations << ", \"minimum_ns\": " << result.minimum_duration
+               << ", \"median_ns\": " << result.median_duration;
+        if (result.name != "construct") {
+            const auto tokens_per_second = result.median_duration == 0 ?
+                                               0.0 :
+                                               static_cast<double>(result.parameters.number_of_tokens) * 1e9
+                                                   / static_cast<double>(result.median_duration);
+            stream << ", \"tokens_per_second\": " << tokens_per_second;
+        }
+        stream << ", \"allocations_per_iteration\": " << result.allocations_per_iteration
+               << ", \"bytes_per_iteration\": " << result.bytes_per_iteration
+               << ", \"peak_memory_kb\": " << result.peak_memory << "}";
+    }
+    stream << "\n    ]\n}\n";
+}
+
+/// run_scenario measures every benchmark of a scenario.
+std::vector<result> run_scenario(const scenario& scenario, std::chrono::nanoseconds minimum_time) {
+    std::vector<result> results;
+    fixture fixture(scenario);
+    const pontella::label help("help", {"h"});
+    const pontella::parser parser(
+        -1, fixture.options.begin(), fixture.options.end(), fixture.flags.begin(), fixture.flags.end());
+    results.push_back(measure("construct", scenario, minimum_time, [&]() {
+        return pontella::parser(
+                   -1, fixture.options.begin(), fixture.options.end(), fixture.flags.begin(), fixture.flags.end())
+            .size();
+    }));
+    results.push_back(measure("parse", scenario, minimum_time, [&]() {
+        return parser.parse(fixture.argc(), fixture.argv.data()).arguments.size();
+    }));
+    results.push_back(measure("parse_view", scenario, minimum_time, [&]() {
+        return parser.parse_view(fixture.argc(), fixture.argv.data()).arguments.size();
+    }));
+    results.push_back(measure("visit", scenario, minimum_time, [&]() {
+        std::size_t count = 0;
+        parser.visit(
+            fixture.argc(),
+            fixture.argv.data(),
+            [&](pontella::slice) { ++count; },
+            [&](const pontella::match&, pontella::slice) { ++count; },
+            [&](const pontella::match&) { ++count; });
+        return count;
+    }));
+    results.push_back(measure("test", scenario, minimum_time, [&]() {
+        return static_cast<std::size_t>(pontella::test(fixture.argc(), fixture.argv.data(), help));
+    }));
+    return results;
+}
+
+/// run_isolated calls run_scenario in a child process (on POSIX systems), so that the peak memory of a scenario
+/// does not include the memory used by the previous ones. The results are sent back through a pipe.
+std::vector<result> run_isolated(const scenario& scenario, std::chrono::nanoseconds minimum_time) {
+#ifdef PONTELLA_MMAP
+    int descriptors[2];
+    if (pipe(descriptors) < 0) {
+        throw std::runtime_error("creating a pipe failed");
+    }
+    const auto pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("fork failed");
+    }
+    if (pid == 0) {
+        close(descriptors[0]);
+        std::ostringstream stream;
+        stream.imbue(std::locale::classic());
+        stream.precision(17);
+        for (const auto& result : run_scenario(scenario, minimum_time)) {
+            stream << result.name << ' ' << result.iterations << ' ' << result.minimum_duration << ' '
+                   << result.median_duration << ' ' << result.allocations_per_iteration << ' '
+                   << result.bytes_per_iteration << ' ' << result.peak_memory << '\n';
+        }
+        const auto message = stream.str();
+        for (std::size_t offset = 0; offset < message.size();) {
+            const auto written = write(descriptors[1], message.data() + offset, message.size() - offset);
+            if (written <= 0) {
+                _exit(1);
+            }
+            offset += static_cast<std::size_t>(written);
+        }
+        _exit(0);
+    }
+    close(descriptors[1]);
+    std::string message;
+    char buffer[4096];
+    for (;;) {
+        const auto size = read(descriptors[0], buffer, sizeof(buffer));
+        if (size <= 0) {
+            break;
+        }
+        message.append(buffer, static_cast<std::size_t>(size));
+    }
+    close(descriptors[0]);
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("the benchmark process failed");
+    }
+    std::vector<result> results;
+    std::istringstream stream(message);
+    stream.imbue(std::locale::classic());
+    result result{"", scenario, 0, 0, 0, 0.0, 0.0, 0};
+    while (stream >> result.name >> result.iterations >> result.minimum_duration >> result.median_duration
+           >> result.allocations_per_iteration >> result.bytes_per_iteration >> result.peak_memory) {
+        results.push_back(result);
+    }
+    return results;
+#else
+    return run_scenario(scenario, minimum_time);
+#endif
+}
+
+int main(int argc, char* argv[]) {
+    return pontella::main(
+        {"pontella_benchmark measures the latency, throughput, allocations and peak memory of the parser",
+         "Syntax: ./pontella_benchmark [options]",
+         "Available options:",
+         "    -o [path], --output [path]                 writes the JSON results to a file (defaults to stdout)",
+         "    -t [duration], --minimum-time [duration]   measures each benchmark for at least the given duration",
+         "                                               (defaults to 200ms)",
+         "    -m [count], --maximum-tokens [count]       skips command lines with more tokens (defaults to 1000000)",
+         "    -h, --help                                 shows this help message"},
+        argc,
+        argv,
+        0,
+        {{"output", {"o"}},
+         {"minimum-time", {"t"}, pontella::duration()},
+         {"maximum-tokens", {"m"}, pontella::integer(1)}},
+        {},
+        [](pontella::command command) {
+            auto minimum_time = std::chrono::nanoseconds(std::chrono::milliseconds(200));
+            if (command.options.find("minimum-time") != command.options.end()) {
+                minimum_time = pontella::to_duration(command.options["minimum-time"]);
+            }
+            std::size_t maximum_tokens = 1000000;
+            if (command.options.find("maximum-tokens") != command.options.end()) {
+                maximum_tokens = static_cast<std::size_t>(pontella::to_integer(command.options["maximum-tokens"]));
+            }
+            std::vector<scenario> scenarios;
+            for (const std::size_t number_of_labels : {10, 100, 1000, 10000}) {
+                scenarios.push_back({number_of_labels, 1, 10000, "mixed"});
+            }
+            for (const std::size_t aliases_per_label : {0, 4}) {
+                scenarios.push_back({1000, aliases_per_label, 10000, "mixed"});
+            }
+            for (const std::size_t number_of_tokens : {1, 100, 1000000}) {
+                scenarios.push_back({100, 1, number_of_tokens, "mixed"});
+            }
+            for (const auto mix : {"name_value", "alias_value", "positional"}) {
+                scenarios.push_back({100, 1, 10000, mix});
+            }
+            std::vector<result> results;
+            for (const auto& scenario : scenarios) {
+                if (scenario.number_of_tokens > maximum_tokens) {
+                    continue;
+                }
+                const auto scenario_results = run_isolated(scenario, minimum_time);
+                results.insert(results.end(), scenario_results.begin(), scenario_results.end());
+                std::cerr << "labels=" << scenario.number_of_labels << " aliases=" << scenario.aliases_per_label
+                          << " tokens=" << scenario.number_of_tokens << " mix=" << scenario.mix << " done\n";
+            }
+            if (command.options.find("output") == command.options.end()) {
+                write_json(std::cout, results);
+            } else {
+                std::ofstream output(command.options["output"]);
+                if (!output.good()) {
+                    throw std::runtime_error("The file '" + command.options["output"] + "' could not be opened");
+                }
+                write_json(output, results);
+            }
+        });
+}
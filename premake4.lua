@@ -15,8 +15,29 @@ solution 'pontella'
             defines {'DEBUG'}
             flags {'Symbols'}
         configuration 'linux'
+            buildoptions {'-std=c++11', '-pthread'}
+            linkoptions {'-std=c++11', '-pthread'}
+        configuration 'macosx'
             buildoptions {'-std=c++11'}
             linkoptions {'-std=c++11'}
+        configuration 'windows'
+            files {'.clang-format'}
+    project 'pontella_benchmark'
+        kind 'ConsoleApp'
+        language 'C++'
+        location 'build'
+        files {'source/*.hpp', 'benchmark/*.cpp'}
+        configuration 'release'
+            targetdir 'build/release'
+            defines {'NDEBUG'}
+            flags {'OptimizeSpeed'}
+        configuration 'debug'
+            targetdir 'build/debug'
+            defines {'DEBUG'}
+            flags {'Symbols'}
+        configuration 'linux'
+            buildoptions {'-std=c++11', '-pthread'}
+            linkoptions {'-std=c++11', '-pthread'}
         configuration 'macosx'
             buildoptions {'-std=c++11'}
             linkoptions {'-std=c++11'}
@@ -1,178 +1,4646 @@
 #pragma once
 
 #include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#define PONTELLA_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define PONTELLA_EXCEPTIONS
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PONTELLA_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
 
 /// pontella is a command  line parser.
 namespace pontella {
 
-    /// command contains parsed arguments, options and flags.
-    struct command {
+    /// throw_exception throws the given exception.
+    /// If exceptions are disabled (for example with -fno-exceptions), it prints the message and aborts instead.
+    template <typename Exception>
+    [[noreturn]] inline void throw_exception(const Exception& exception) {
+#ifdef PONTELLA_EXCEPTIONS
+        throw exception;
+#else
+        std::cerr << exception.what() << std::endl;
+        std::abort();
+#endif
+    }
+
+    /// rebind_allocator converts an allocator to an allocator of another type.
+    template <typename Allocator, typename Type>
+    using rebind_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Type>;
+
+    /// string_hash hashes strings with any allocator, since C++11 only specializes std::hash for std::string.
+    struct string_hash {
+        template <typename String>
+        std::size_t operator()(const String& string) const {
+            uint64_t hash = 14695981039346656037ull;
+            for (auto character : string) {
+                hash = (hash ^ static_cast<uint8_t>(character)) * 1099511628211ull;
+            }
+            return static_cast<std::size_t>(hash);
+        }
+    };
+
+    /// hash_type selects std::hash for std::string, and string_hash otherwise.
+    template <typename String>
+    struct hash_type {
+        typedef string_hash type;
+    };
+    template <>
+    struct hash_type<std::string> {
+        typedef std::hash<std::string> type;
+    };
+
+    /// arena is a monotonic memory resource: it serves allocations from large blocks and ignores deallocations.
+    /// reset releases every allocation at once and keeps the blocks, so that a warm arena does not call new.
+    /// An arena must not be shared by several threads.
+    class arena {
+        public:
+        arena(std::size_t block_size = 1 << 16) : _block_size(block_size), _block_index(0), _offset(0) {}
+        arena(const arena&) = delete;
+        arena(arena&&) = default;
+        arena& operator=(const arena&) = delete;
+        arena& operator=(arena&&) = default;
+        ~arena() {}
+
+        /// allocate returns a memory area with the given size and alignment, valid until the next reset.
+        void* allocate(std::size_t size, std::size_t alignment) {
+            for (;;) {
+                if (_block_index == _blocks.size()) {
+                    const auto block_size = std::max(_block_size, size + alignment);
+                    _blocks.emplace_back(std::unique_ptr<uint8_t[]>(new uint8_t[block_size]), block_size);
+                }
+                const auto& block = _blocks[_block_index];
+                const auto address = reinterpret_cast<std::uintptr_t>(block.first.get()) + _offset;
+                const auto padding = (alignment - address % alignment) % alignment;
+                if (_offset + padding + size <= block.second) {
+                    _offset += padding + size;
+                    return reinterpret_cast<void*>(address + padding);
+                }
+                ++_block_index;
+                _offset = 0;
+            }
+        }
+
+        /// reset releases every allocation.
+        void reset() {
+            _block_index = 0;
+            _offset = 0;
+        }
+
+        /// capacity returns the total size of the blocks.
+        std::size_t capacity() const {
+            std::size_t capacity = 0;
+            for (const auto& block : _blocks) {
+                capacity += block.second;
+            }
+            return capacity;
+        }
+
+        protected:
+        std::size_t _block_size;
+        std::vector<std::pair<std::unique_ptr<uint8_t[]>, std::size_t>> _blocks;
+        std::size_t _block_index;
+        std::size_t _offset;
+    };
+
+    /// arena_allocator is a standard allocator backed by an arena.
+    template <typename Type>
+    class arena_allocator {
+        public:
+        template <typename OtherType>
+        friend class arena_allocator;
+        typedef Type value_type;
+        arena_allocator(arena& arena) : _arena(&arena) {}
+        template <typename OtherType>
+        arena_allocator(const arena_allocator<OtherType>& other) : _arena(other._arena) {}
+        arena_allocator(const arena_allocator&) = default;
+        arena_allocator(arena_allocator&&) = default;
+        arena_allocator& operator=(const arena_allocator&) = default;
+        arena_allocator& operator=(arena_allocator&&) = default;
+        ~arena_allocator() {}
+
+        /// allocate reserves memory for size objects.
+        Type* allocate(std::size_t size) {
+            return static_cast<Type*>(_arena->allocate(size * sizeof(Type), alignof(Type)));
+        }
+
+        /// deallocate does nothing, the memory is released by arena::reset.
+        void deallocate(Type*, std::size_t) {}
+
+        template <typename OtherType>
+        bool operator==(const arena_allocator<OtherType>& other) const {
+            return _arena == other._arena;
+        }
+        template <typename OtherType>
+        bool operator!=(const arena_allocator<OtherType>& other) const {
+            return _arena != other._arena;
+        }
+
+        protected:
+        arena* _arena;
+    };
+
+    /// parameter_kind lists the types of option parameters.
+    enum class parameter_kind { string, integer, floating, enumeration, duration, integer_list, floating_list, path };
+
+    /// path_constraint lists the checks of path parameters, which can be combined with |.
+    enum path_constraint : uint32_t {
+        /// path_exists requires an existing file, directory or other filesystem entry.
+        path_exists = 1,
+
+        /// path_is_file requires an existing regular file (symbolic links are followed).
+        path_is_file = 2,
+
+        /// path_is_directory requires an existing directory.
+        path_is_directory = 4,
+
+        /// path_is_readable requires an existing entry that the process can read.
+        path_is_readable = 8,
+
+        /// path_parent_exists requires the parent of the path to be an existing directory (for example, for outputs).
+        path_parent_exists = 16,
+    };
+
+    struct path_entry;
+
+    /// path_check checks size registered paths with at most number_of_threads threads, and sets is_valid[index] to 1
+    /// for each valid path and to 0 otherwise (see check_path_entries).
+    typedef void (*path_check)(
+        const path_entry* entries,
+        std::size_t size,
+        uint8_t* is_valid,
+        std::size_t number_of_threads);
+
+    /// parameter_type describes the type of an option's parameter, and its inclusive range.
+    /// Integer bounds are used by integers and integer lists, and by durations (in nanoseconds).
+    /// Floating bounds are used by floating numbers and floating lists.
+    /// path_constraints is a combination of path_constraint values, used by paths.
+    /// check_paths is set by path, and is the only reference to the threads that check paths: programs that do not
+    /// create path types do not compile them.
+    struct parameter_type {
+        parameter_kind kind;
+        int64_t integer_minimum;
+        int64_t integer_maximum;
+        double floating_minimum;
+        double floating_maximum;
+        std::vector<std::string> choices;
+        uint32_t path_constraints;
+        path_check check_paths;
+
+        parameter_type() :
+            kind(parameter_kind::string),
+            integer_minimum(std::numeric_limits<int64_t>::min()),
+            integer_maximum(std::numeric_limits<int64_t>::max()),
+            floating_minimum(-std::numeric_limits<double>::infinity()),
+            floating_maximum(std::numeric_limits<double>::infinity()),
+            path_constraints(0),
+            check_paths(nullptr) {}
+    };
+
+    /// integer creates the type of an integer parameter (for example "-42").
+    inline parameter_type integer(
+        int64_t minimum = std::numeric_limits<int64_t>::min(),
+        int64_t maximum = std::numeric_limits<int64_t>::max()) {
+        parameter_type type;
+        type.kind = parameter_kind::integer;
+        type.integer_minimum = minimum;
+        type.integer_maximum = maximum;
+        return type;
+    }
+
+    /// floating creates the type of a floating point parameter (for example "-1.5e3").
+    inline parameter_type floating(
+        double minimum = -std::numeric_limits<double>::infinity(),
+        double maximum = std::numeric_limits<double>::infinity()) {
+        parameter_type type;
+        type.kind = parameter_kind::floating;
+        type.floating_minimum = minimum;
+        type.floating_maximum = maximum;
+        return type;
+    }
+
+    /// enumeration creates the type of a parameter which must be one of the given choices.
+    /// The converted parameter is the index of the choice.
+    inline parameter_type enumeration(std::vector<std::string> choices) {
+        parameter_type type;
+        type.kind = parameter_kind::enumeration;
+        type.integer_minimum = 0;
+        type.integer_maximum = static_cast<int64_t>(choices.size()) - 1;
+        type.choices = std::move(choices);
+        return type;
+    }
+
+    /// duration creates the type of a duration parameter: a number followed by a unit among ns, us, ms, s, m and h
+    /// (for example "1.5s"). The converted parameter is a number of nanoseconds.
+    inline parameter_type duration(
+        std::chrono::nanoseconds minimum = std::chrono::nanoseconds::zero(),
+        std::chrono::nanoseconds maximum = std::chrono::nanoseconds::max()) {
+        auto type = integer(minimum.count(), maximum.count());
+        type.kind = parameter_kind::duration;
+        return type;
+    }
+
+    /// integer_list creates the type of a comma-separated list of integers (for example "1,2,3").
+    inline parameter_type integer_list(
+        int64_t minimum = std::numeric_limits<int64_t>::min(),
+        int64_t maximum = std::numeric_limits<int64_t>::max()) {
+        auto type = integer(minimum, maximum);
+        type.kind = parameter_kind::integer_list;
+        return type;
+    }
+
+    /// floating_list creates the type of a comma-separated list of floating point numbers (for example "0.1,0.2").
+    inline parameter_type floating_list(
+        double minimum = -std::numeric_limits<double>::infinity(),
+        double maximum = std::numeric_limits<double>::infinity()) {
+        auto type = floating(minimum, maximum);
+        type.kind = parameter_kind::floating_list;
+        return type;
+    }
+
+    inline void check_path_entries(
+        const path_entry* entries,
+        std::size_t size,
+        uint8_t* is_valid,
+        std::size_t number_of_threads);
+
+    /// path creates the type of a filesystem path, checked against the given constraints (for example
+    /// `pontella::path_is_file | pontella::path_is_readable`). The filesystem is queried after the command line is
+    /// parsed, concurrently for every path (see path_checker).
+    /// On systems that are neither POSIX nor Windows, directories cannot be detected, hence path throws if the
+    /// constraints include path_is_directory or path_parent_exists.
+    inline parameter_type path(uint32_t constraints = 0) {
+#if !defined(PONTELLA_MMAP) && !defined(_WIN32)
+        if ((constraints & (path_is_directory | path_parent_exists)) != 0) {
+            throw_exception(std::logic_error("Directory constraints are not supported on this system"));
+        }
+#endif
+        parameter_type type;
+        type.kind = parameter_kind::path;
+        type.path_constraints = constraints;
+        type.check_paths = check_path_entries;
+        return type;
+    }
+
+    /// label represents an option or flag name, and its aliases.
+    /// A repeatable option collects every parameter given to the program, instead of keeping only the first one.
+    /// The parameter of an option with a type other than string is converted and checked during parsing.
+    struct label {
+        std::string name;
+        std::unordered_set<std::string> aliases;
+        bool is_repeatable;
+        parameter_type type;
+
+        label() : is_repeatable(false) {}
+        label(
+            std::string name,
+            std::unordered_set<std::string> aliases = {},
+            bool is_repeatable = false,
+            parameter_type type = parameter_type()) :
+            name(std::move(name)),
+            aliases(std::move(aliases)),
+            is_repeatable(is_repeatable),
+            type(std::move(type)) {}
+        label(std::string name, std::unordered_set<std::string> aliases, parameter_type type) :
+            label(std::move(name), std::move(aliases), false, std::move(type)) {}
+    };
+
+    /// validate throws if the given string does not match the criterions for being an option or flag.
+    inline void validate(const std::string& name_or_alias, bool is_option, bool is_name) {
+        if (name_or_alias.empty()) {
+            throw_exception(std::logic_error(
+                std::string(is_option ? "An option" : "A flag") + " " + (is_name ? "name " : "alias") + " is empty"));
+        }
+        const auto prefix = [&]() {
+            return std::string("The ") + (is_option ? "option" : "flag") + " " + (is_name ? "name" : "alias") + " '"
+                   + name_or_alias + "' ";
+        };
+        if (name_or_alias[0] == '-') {
+            throw_exception(std::logic_error(prefix() + "starts with the charcater '-'"));
+        }
+        for (auto character : name_or_alias) {
+            if (isspace(character)) {
+                throw_exception(std::logic_error(prefix() + "contains white-space characters"));
+            }
+            if (character == '=') {
+                throw_exception(std::logic_error(prefix() + "contains the character '='"));
+            }
+        }
+    }
+
+    /// slice is a non-owning reference to a range of characters, such as a part of an element of argv.
+    struct slice {
+        const char* data;
+        std::size_t size;
+
+        constexpr slice() : data(nullptr), size(0) {}
+        constexpr slice(const char* data, std::size_t size) : data(data), size(size) {}
+        slice(const char* c_string) : data(c_string), size(std::strlen(c_string)) {}
+        slice(const std::string& string) : data(string.data()), size(string.size()) {}
+
+        /// to_string copies the characters.
+        std::string to_string() const {
+            return std::string(data, size);
+        }
+    };
+
+    /// compare orders slices lexicographically, and returns a negative value, zero or a positive value.
+    inline int compare(slice first, slice second) {
+        const auto size = std::min(first.size, second.size);
+        const auto result = size == 0 ? 0 : std::memcmp(first.data, second.data, size);
+        if (result != 0) {
+            return result;
+        }
+        return first.size < second.size ? -1 : (first.size > second.size ? 1 : 0);
+    }
+
+    /// number holds a converted parameter.
+    /// integer is used by integers, integer lists, enumerations (index of the choice) and durations (nanoseconds).
+    /// floating is used by floating numbers and floating lists.
+    union number {
+        int64_t integer;
+        double floating;
+    };
+
+    /// is_list determines whether the given kind is a comma-separated list.
+    inline bool is_list(parameter_kind kind) {
+        return kind == parameter_kind::integer_list || kind == parameter_kind::floating_list;
+    }
+
+    /// read_integer converts a decimal integer with an optional sign, and returns false on syntax errors and
+    /// overflows. It neither allocates memory nor depends on the locale.
+    inline bool read_integer(slice characters, int64_t& value) {
+        std::size_t index = 0;
+        const auto is_negative = characters.size > 0 && characters.data[0] == '-';
+        if (characters.size > 0 && (characters.data[0] == '-' || characters.data[0] == '+')) {
+            ++index;
+        }
+        if (index == characters.size) {
+            return false;
+        }
+        const uint64_t limit = is_negative ? (uint64_t(1) << 63) : (uint64_t(1) << 63) - 1;
+        uint64_t magnitude = 0;
+        for (; index < characters.size; ++index) {
+            const auto character = characters.data[index];
+            if (character < '0' || character > '9') {
+                return false;
+            }
+            const auto digit = static_cast<uint64_t>(character - '0');
+            if (magnitude > (limit - digit) / 10) {
+                return false;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+        value = is_negative ? (magnitude == 0 ? 0 : -static_cast<int64_t>(magnitude - 1) - 1) :
+                              static_cast<int64_t>(magnitude);
+        return true;
+    }
+
+    /// big_integer is a fixed-capacity unsigned integer, used by read_floating to round numbers that cannot be
+    /// converted with a single floating point operation. Its capacity covers the significant digits kept by
+    /// read_floating, multiplied by the powers of two and five needed to compare them with a double.
+    struct big_integer {
+        explicit big_integer(uint64_t value) : size(0) {
+            for (; value > 0; value >>= 32) {
+                limbs[size] = static_cast<uint32_t>(value);
+                ++size;
+            }
+        }
+
+        /// multiply replaces the integer with integer × factor + addend.
+        void multiply(uint32_t factor, uint32_t addend) {
+            uint64_t carry = addend;
+            for (std::size_t index = 0; index < size; ++index) {
+                carry += static_cast<uint64_t>(limbs[index]) * factor;
+                limbs[index] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            if (carry > 0 && size < capacity) {
+                limbs[size] = static_cast<uint32_t>(carry);
+                ++size;
+            }
+        }
+
+        /// multiply_by_power_of_five replaces the integer with integer × 5^exponent.
+        void multiply_by_power_of_five(int64_t exponent) {
+            static const uint32_t powers_of_five[] = {
+                1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125, 9765625, 48828125, 244140625, 1220703125};
+            for (; exponent >= 13; exponent -= 13) {
+                multiply(powers_of_five[13], 0);
+            }
+            multiply(powers_of_five[exponent], 0);
+        }
+
+        /// shift_left replaces the integer with integer × 2^bits.
+        void shift_left(int64_t bits) {
+            if (size == 0) {
+                return;
+            }
+            const auto limbs_shift = static_cast<std::size_t>(bits / 32);
+            const auto bits_shift = static_cast<uint32_t>(bits % 32);
+            auto new_size = size + limbs_shift + (bits_shift > 0 ? 1 : 0);
+            if (new_size > capacity) {
+                new_size = capacity;
+            }
+            for (auto index = new_size; index > limbs_shift; --index) {
+                const auto source = index - 1 - limbs_shift;
+                const auto high = source < size ? limbs[source] : 0;
+                const auto low = source > 0 && source - 1 < size ? limbs[source - 1] : 0;
+                limbs[index - 1] = bits_shift == 0 ? high :
+                                                     static_cast<uint32_t>(
+                                                         (high << bits_shift) | (low >> (32 - bits_shift)));
+            }
+            std::fill(limbs, limbs + std::min(limbs_shift, new_size), 0u);
+            size = new_size;
+            while (size > 0 && limbs[size - 1] == 0) {
+                --size;
+            }
+        }
+
+        static const std::size_t capacity = 160;
+        uint32_t limbs[capacity];
+        std::size_t size;
+    };
+
+    /// compare returns a negative value if first is smaller than second, zero if they are equal, and a positive value
+    /// otherwise.
+    inline int compare(const big_integer& first, const big_integer& second) {
+        if (first.size != second.size) {
+            return first.size < second.size ? -1 : 1;
+        }
+        for (auto index = first.size; index > 0; --index) {
+            if (first.limbs[index - 1] != second.limbs[index - 1]) {
+                return first.limbs[index - 1] < second.limbs[index - 1] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    /// round_decimal finds the double nearest to digits × 10^exponent (ties to even), starting from an estimate
+    /// within a few units in the last place. Each step compares the number with the halfway point between the
+    /// current double and its neighbour, computed exactly with big integers. It returns false on overflows.
+    inline bool round_decimal(const big_integer& digits, int64_t exponent, double estimate, double& value) {
+        auto compare_with_binary = [&](uint64_t mantissa, int64_t binary_exponent) {
+            big_integer decimal(digits);
+            big_integer binary(mantissa);
+            if (exponent > 0) {
+                decimal.multiply_by_power_of_five(exponent);
+            } else {
+                binary.multiply_by_power_of_five(-exponent);
+            }
+            if (exponent > binary_exponent) {
+                decimal.shift_left(exponent - binary_exponent);
+            } else {
+                binary.shift_left(binary_exponent - exponent);
+            }
+            return compare(decimal, binary);
+        };
+        const auto maximum = std::numeric_limits<double>::max();
+        value = std::isinf(estimate) ? maximum : estimate;
+        for (;;) {
+            auto binary_exponent = 0;
+            std::frexp(value, &binary_exponent);
+            const auto exponent_of_unit =
+                value == 0.0 || binary_exponent - 53 < -1074 ? int64_t(-1074) : int64_t(binary_exponent - 53);
+            const auto mantissa = static_cast<uint64_t>(std::ldexp(value, static_cast<int>(-exponent_of_unit)));
+            const auto above = compare_with_binary(2 * mantissa + 1, exponent_of_unit - 1);
+            if (above > 0 || (above == 0 && (mantissa & 1) == 1)) {
+                if (value == maximum) {
+                    return false;
+                }
+                value = std::nextafter(value, maximum);
+                if (above == 0) {
+                    return true;
+                }
+                continue;
+            }
+            if (mantissa == 0) {
+                return true;
+            }
+            const auto below = mantissa == (uint64_t(1) << 52) && exponent_of_unit > -1074 ?
+                                   compare_with_binary(4 * mantissa - 1, exponent_of_unit - 2) :
+                                   compare_with_binary(2 * mantissa - 1, exponent_of_unit - 1);
+            if (below < 0 || (below == 0 && (mantissa & 1) == 1)) {
+                value = std::nextafter(value, 0.0);
+                if (below == 0) {
+                    return true;
+                }
+                continue;
+            }
+            return true;
+        }
+    }
+
+    /// read_floating converts a decimal number with an optional sign, fraction and exponent (for example "-1.5e3"),
+    /// and returns false on syntax errors and overflows. It neither allocates memory nor depends on the locale.
+    /// Numbers with a mantissa up to 2^53 and a decimal exponent in [-22, 22] are converted with a single floating
+    /// point operation. Other numbers are correctly rounded by round_decimal, from their first 780 significant digits
+    /// (followed by a non-zero digit if the remaining digits are not all zeros, which is enough to round exactly).
+    inline bool read_floating(slice characters, double& value) {
+        static const double powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                               1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                               1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        std::size_t index = 0;
+        const auto is_negative = characters.size > 0 && characters.data[0] == '-';
+        if (characters.size > 0 && (characters.data[0] == '-' || characters.data[0] == '+')) {
+            ++index;
+        }
+        const auto digits_begin = index;
+        uint64_t mantissa = 0;
+        int64_t exponent = 0;
+        std::size_t number_of_digits = 0;
+        std::size_t number_of_significant_digits = 0;
+        auto is_fraction = false;
+        for (; index < characters.size; ++index) {
+            const auto character = characters.data[index];
+            if (character == '.' && !is_fraction) {
+                is_fraction = true;
+                continue;
+            }
+            if (character < '0' || character > '9') {
+                break;
+            }
+            ++number_of_digits;
+            if (number_of_significant_digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(character - '0');
+                if (mantissa > 0) {
+                    ++number_of_significant_digits;
+                }
+                if (is_fraction) {
+                    --exponent;
+                }
+            } else if (!is_fraction) {
+                ++exponent;
+            }
+        }
+        if (number_of_digits == 0) {
+            return false;
+        }
+        const auto digits_end = index;
+        int64_t explicit_exponent = 0;
+        if (index < characters.size && (characters.data[index] == 'e' || characters.data[index] == 'E')) {
+            ++index;
+            const auto is_exponent_negative = index < characters.size && characters.data[index] == '-';
+            if (index < characters.size && (characters.data[index] == '-' || characters.data[index] == '+')) {
+                ++index;
+            }
+            if (index == characters.size) {
+                return false;
+            }
+            for (; index < characters.size; ++index) {
+                const auto character = characters.data[index];
+                if (character < '0' || character > '9') {
+                    return false;
+                }
+                if (explicit_exponent < 100000) {
+                    explicit_exponent = explicit_exponent * 10 + (character - '0');
+                }
+            }
+            if (is_exponent_negative) {
+                explicit_exponent = -explicit_exponent;
+            }
+            exponent += explicit_exponent;
+        }
+        if (index != characters.size) {
+            return false;
+        }
+        if (mantissa == 0) {
+            value = is_negative ? -0.0 : 0.0;
+            return true;
+        }
+        if (mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+            value = exponent < 0 ? static_cast<double>(mantissa) / powers_of_ten[-exponent] :
+                                   static_cast<double>(mantissa) * powers_of_ten[exponent];
+            if (is_negative) {
+                value = -value;
+            }
+            return true;
+        }
+        big_integer digits(0);
+        int64_t point = 0;
+        std::size_t number_of_kept_digits = 0;
+        uint32_t chunk = 0;
+        std::size_t chunk_size = 0;
+        auto is_significant = false;
+        auto is_truncated = false;
+        is_fraction = false;
+        for (index = digits_begin; index < digits_end; ++index) {
+            const auto character = characters.data[index];
+            if (character == '.') {
+                is_fraction = true;
+                continue;
+            }
+            const auto digit = static_cast<uint32_t>(character - '0');
+            if (!is_significant) {
+                if (digit == 0) {
+                    if (is_fraction) {
+                        --point;
+                    }
+                    continue;
+                }
+                is_significant = true;
+            }
+            if (!is_fraction) {
+                ++point;
+            }
+            if (number_of_kept_digits < 780) {
+                chunk = chunk * 10 + digit;
+                ++chunk_size;
+                ++number_of_kept_digits;
+                if (chunk_size == 9) {
+                    digits.multiply(1000000000, chunk);
+                    chunk = 0;
+                    chunk_size = 0;
+                }
+            } else if (digit > 0) {
+                is_truncated = true;
+            }
+        }
+        digits.multiply(static_cast<uint32_t>(powers_of_ten[chunk_size]), chunk);
+        if (is_truncated) {
+            digits.multiply(10, 1);
+            ++number_of_kept_digits;
+        }
+        // the number is in [10^(magnitude - 1), 10^magnitude)
+        const auto magnitude = point + explicit_exponent;
+        if (magnitude > 309) {
+            return false;
+        }
+        if (magnitude < -323) {
+            value = is_negative ? -0.0 : 0.0;
+            return true;
+        }
+        auto estimate = static_cast<double>(mantissa);
+        for (; exponent > 22; exponent -= 22) {
+            estimate *= powers_of_ten[22];
+        }
+        for (; exponent < -22; exponent += 22) {
+            estimate /= powers_of_ten[22];
+        }
+        estimate = exponent < 0 ? estimate / powers_of_ten[-exponent] : estimate * powers_of_ten[exponent];
+        if (!round_decimal(
+                digits, magnitude - static_cast<int64_t>(number_of_kept_digits), estimate, value)) {
+            return false;
+        }
+        if (is_negative) {
+            value = -value;
+        }
+        return true;
+    }
+
+    /// convert converts the parameter of an option with a scalar type (integer, floating, enumeration or duration),
+    /// and returns false if the parameter does not match the type or its range.
+    inline bool convert(const parameter_type& type, slice parameter, number& value) {
+        switch (type.kind) {
+            case parameter_kind::integer:
+            case parameter_kind::integer_list:
+                return read_integer(parameter, value.integer) && value.integer >= type.integer_minimum
+                       && value.integer <= type.integer_maximum;
+            case parameter_kind::floating:
+            case parameter_kind::floating_list:
+                return read_floating(parameter, value.floating) && value.floating >= type.floating_minimum
+                       && value.floating <= type.floating_maximum;
+            case parameter_kind::enumeration:
+                for (std::size_t index = 0; index < type.choices.size(); ++index) {
+                    if (compare(slice(type.choices[index]), parameter) == 0) {
+                        value.integer = static_cast<int64_t>(index);
+                        return true;
+                    }
+                }
+                return false;
+            case parameter_kind::duration: {
+                static const std::pair<const char*, double> units[] = {
+                    {"ns", 1e0}, {"us", 1e3}, {"ms", 1e6}, {"s", 1e9}, {"m", 60e9}, {"h", 3600e9}};
+                auto unit_begin = parameter.size;
+                while (unit_begin > 0 && std::isalpha(static_cast<unsigned char>(parameter.data[unit_begin - 1]))) {
+                    --unit_begin;
+                }
+                const slice unit(parameter.data + unit_begin, parameter.size - unit_begin);
+                double count = 0.0;
+                if (!read_floating(slice(parameter.data, unit_begin), count)) {
+                    return false;
+                }
+                for (const auto& name_and_factor : units) {
+                    if (compare(slice(name_and_factor.first), unit) == 0) {
+                        const auto nanoseconds = count * name_and_factor.second;
+                        if (std::fabs(nanoseconds) >= 9.2e18) {
+                            return false;
+                        }
+                        value.integer = std::llround(nanoseconds);
+                        return value.integer >= type.integer_minimum && value.integer <= type.integer_maximum;
+                    }
+                }
+                return false;
+            }
+            case parameter_kind::path:
+                value.integer = 0;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /// convert_list converts each element of a comma-separated list parameter, and calls handle_number with each
+    /// element. It returns false if an element does not match the type or its range.
+    /// Commas are found with std::memchr, which standard libraries implement with vector instructions.
+    template <typename HandleNumber>
+    inline bool convert_list(const parameter_type& type, slice parameter, HandleNumber handle_number) {
+        if (parameter.size == 0) {
+            return true;
+        }
+        auto begin = parameter.data;
+        const auto end = parameter.data + parameter.size;
+        for (;;) {
+            const auto comma = static_cast<const char*>(std::memchr(begin, ',', static_cast<std::size_t>(end - begin)));
+            const auto element_end = comma == nullptr ? end : comma;
+            number value;
+            if (!convert(type, slice(begin, static_cast<std::size_t>(element_end - begin)), value)) {
+                return false;
+            }
+            handle_number(value);
+            if (comma == nullptr) {
+                return true;
+            }
+            begin = comma + 1;
+        }
+    }
+
+    /// describe returns a human-readable description of a parameter type, used in error messages.
+    inline std::string describe(const parameter_type& type) {
+        std::ostringstream stream;
+        stream.imbue(std::locale::classic());
+        switch (type.kind) {
+            case parameter_kind::string:
+                stream << "a string";
+                break;
+            case parameter_kind::integer:
+                stream << "an integer";
+                break;
+            case parameter_kind::floating:
+                stream << "a number";
+                break;
+            case parameter_kind::enumeration:
+                stream << "one of";
+                for (std::size_t index = 0; index < type.choices.size(); ++index) {
+                    stream << (index == 0 ? " '" : ", '") << type.choices[index] << "'";
+                }
+                return stream.str();
+            case parameter_kind::duration:
+                stream << "a duration with a unit among ns, us, ms, s, m and h";
+                break;
+            case parameter_kind::integer_list:
+                stream << "a comma-separated list of integers";
+                break;
+            case parameter_kind::floating_list:
+                stream << "a comma-separated list of numbers";
+                break;
+            case parameter_kind::path: {
+                const auto constraints = type.path_constraints;
+                const auto is_existing =
+                    (constraints & (path_exists | path_is_file | path_is_directory | path_is_readable)) != 0;
+                const auto is_readable = (constraints & path_is_readable) != 0;
+                stream << (is_existing ? "an existing " : "a ") << (is_readable ? "readable " : "")
+                       << ((constraints & path_is_file) != 0 ?
+                               "regular file" :
+                               ((constraints & path_is_directory) != 0 ? "directory" : "path"));
+                if ((constraints & path_parent_exists) != 0) {
+                    stream << " in an existing directory";
+                }
+                return stream.str();
+            }
+        }
+        if (type.kind == parameter_kind::floating || type.kind == parameter_kind::floating_list) {
+            if (type.floating_minimum > -std::numeric_limits<double>::infinity()
+                || type.floating_maximum < std::numeric_limits<double>::infinity()) {
+                stream << " in the range [" << type.floating_minimum << ", " << type.floating_maximum << "]";
+            }
+        } else if (
+            type.integer_minimum > std::numeric_limits<int64_t>::min()
+            || type.integer_maximum < std::numeric_limits<int64_t>::max()) {
+            const auto unit = type.kind == parameter_kind::duration ? "ns" : "";
+            stream << " in the range [" << type.integer_minimum << unit << ", " << type.integer_maximum << unit << "]";
+        }
+        return stream.str();
+    }
+
+    /// to_integer converts a parameter to an integer in the given range, and throws if the conversion fails.
+    inline int64_t to_integer(
+        slice parameter,
+        int64_t minimum = std::numeric_limits<int64_t>::min(),
+        int64_t maximum = std::numeric_limits<int64_t>::max()) {
+        const auto type = integer(minimum, maximum);
+        number value;
+        if (!convert(type, parameter, value)) {
+            throw_exception(
+                std::runtime_error("Expected " + describe(type) + " (got '" + parameter.to_string() + "')"));
+        }
+        return value.integer;
+    }
+
+    /// to_floating converts a parameter to a floating point number in the given range, and throws if the conversion
+    /// fails.
+    inline double to_floating(
+        slice parameter,
+        double minimum = -std::numeric_limits<double>::infinity(),
+        double maximum = std::numeric_limits<double>::infinity()) {
+        const auto type = floating(minimum, maximum);
+        number value;
+        if (!convert(type, parameter, value)) {
+            throw_exception(
+                std::runtime_error("Expected " + describe(type) + " (got '" + parameter.to_string() + "')"));
+        }
+        return value.floating;
+    }
+
+    /// to_duration converts a parameter to a duration in the given range, and throws if the conversion fails.
+    inline std::chrono::nanoseconds to_duration(
+        slice parameter,
+        std::chrono::nanoseconds minimum = std::chrono::nanoseconds::zero(),
+        std::chrono::nanoseconds maximum = std::chrono::nanoseconds::max()) {
+        const auto type = duration(minimum, maximum);
+        number value;
+        if (!convert(type, parameter, value)) {
+            throw_exception(
+                std::runtime_error("Expected " + describe(type) + " (got '" + parameter.to_string() + "')"));
+        }
+        return std::chrono::nanoseconds(value.integer);
+    }
+
+    /// basic_command contains parsed arguments, options and flags, allocated with the given allocator.
+    /// repeated_range is the sequence of parameters of a repeatable option stored in a basic_command.
+    /// It dereferences to slices that point to the command's values, hence it is valid as long as the command is
+    /// neither modified nor destroyed.
+    class repeated_range {
+        public:
+        typedef std::pair<std::size_t, std::size_t> range;
+
+        /// iterator reads the parameters in order.
+        class iterator {
+            public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef slice value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const slice* pointer;
+            typedef slice reference;
+
+            iterator(const char* values, const range* current) : _values(values), _current(current) {}
+
+            slice operator*() const {
+                return slice(_values + _current->first, _current->second - _current->first);
+            }
+
+            iterator& operator++() {
+                ++_current;
+                return *this;
+            }
+
+            iterator operator++(int) {
+                auto copy = *this;
+                ++_current;
+                return copy;
+            }
+
+            bool operator==(const iterator& other) const {
+                return _current == other._current;
+            }
+
+            bool operator!=(const iterator& other) const {
+                return _current != other._current;
+            }
+
+            protected:
+            const char* _values;
+            const range* _current;
+        };
+
+        repeated_range(const char* values, const range* begin, const range* end) :
+            _values(values),
+            _begin(begin),
+            _end(end) {}
+
+        iterator begin() const {
+            return iterator(_values, _begin);
+        }
+
+        iterator end() const {
+            return iterator(_values, _end);
+        }
+
+        /// size returns the number of parameters.
+        std::size_t size() const {
+            return static_cast<std::size_t>(_end - _begin);
+        }
+
+        /// empty determines whether the option was not given to the program.
+        bool empty() const {
+            return _begin == _end;
+        }
+
+        /// operator[] returns the parameter with the given index.
+        slice operator[](std::size_t index) const {
+            return slice(_values + _begin[index].first, _begin[index].second - _begin[index].first);
+        }
+
+        protected:
+        const char* _values;
+        const range* _begin;
+        const range* _end;
+    };
+
+    template <typename Allocator>
+    struct basic_command {
+        typedef std::basic_string<char, std::char_traits<char>, rebind_allocator<Allocator, char>> string;
+        typedef typename hash_type<string>::type hash;
+        typedef std::vector<string, rebind_allocator<Allocator, string>> arguments_type;
+        typedef std::unordered_map<
+            string,
+            string,
+            hash,
+            std::equal_to<string>,
+            rebind_allocator<Allocator, std::pair<const string, string>>>
+            options_type;
+        typedef std::unordered_set<string, hash, std::equal_to<string>, rebind_allocator<Allocator, string>> flags_type;
+        typedef std::pair<std::size_t, std::size_t> range;
+        typedef std::vector<range, rebind_allocator<Allocator, range>> ranges_type;
+        typedef std::unordered_map<
+            string,
+            range,
+            hash,
+            std::equal_to<string>,
+            rebind_allocator<Allocator, std::pair<const string, range>>>
+            repeated_type;
+
         /// arguments contains the positionnal arguments given to the program.
-        std::vector<std::string> arguments;
+        arguments_type arguments;
 
         /// options contains the named options and the associated parameter given to the program.
-        std::unordered_map<std::string, std::string> options;
+        /// If an option is given several times, the first parameter is kept.
+        options_type options;
+
+        /// flags contains the named flags given to the program.
+        flags_type flags;
+
+        /// values contains the characters of every parameter of the repeatable options given to the program.
+        string values;
+
+        /// ranges contains the index of the first character and past the last character in values of each parameter
+        /// of the repeatable options, grouped by option, in order for each option.
+        ranges_type ranges;
+
+        /// repeated maps the name of each repeatable option given to the program to the index of its first parameter
+        /// in ranges and the index past its last parameter.
+        repeated_type repeated;
+
+        /// repeated_values returns the parameters of the repeatable option with the given name, in order (an empty
+        /// range if the option was not given to the program).
+        repeated_range repeated_values(slice name) const {
+            const auto name_and_range = repeated.find(string(name.data, name.size, repeated.get_allocator()));
+            if (name_and_range == repeated.end()) {
+                return repeated_range(values.data(), ranges.data(), ranges.data());
+            }
+            return repeated_range(
+                values.data(),
+                ranges.data() + name_and_range->second.first,
+                ranges.data() + name_and_range->second.second);
+        }
+    };
+
+    /// command contains parsed arguments, options and flags.
+    typedef basic_command<std::allocator<char>> command;
+
+    /// make_command creates an empty command whose containers use the given allocator.
+    template <typename Allocator>
+    inline basic_command<Allocator> make_command(const Allocator& allocator) {
+        typedef basic_command<Allocator> command_type;
+        return command_type{
+            typename command_type::arguments_type(allocator),
+            typename command_type::options_type(
+                0, typename command_type::hash(), std::equal_to<typename command_type::string>(), allocator),
+            typename command_type::flags_type(
+                0, typename command_type::hash(), std::equal_to<typename command_type::string>(), allocator),
+            typename command_type::string(allocator),
+            typename command_type::ranges_type(allocator),
+            typename command_type::repeated_type(
+                0, typename command_type::hash(), std::equal_to<typename command_type::string>(), allocator)};
+    }
+
+    /// group_by_id sorts (id, value) pairs by id with a counting sort, and keeps the order of each id.
+    /// grouped receives the values, and offsets receives the index of the first value of each id, followed by the
+    /// number of values. size is the number of ids.
+    template <typename IdsAndValues, typename Offsets, typename Values>
+    inline void group_by_id(const IdsAndValues& ids_and_values, std::size_t size, Offsets& offsets, Values& grouped) {
+        offsets.resize(size + 1, 0);
+        for (const auto& id_and_value : ids_and_values) {
+            ++offsets[id_and_value.first + 1];
+        }
+        for (std::size_t id = 0; id < size; ++id) {
+            offsets[id + 1] += offsets[id];
+        }
+        grouped.resize(ids_and_values.size());
+        for (const auto& id_and_value : ids_and_values) {
+            grouped[offsets[id_and_value.first]] = id_and_value.second;
+            ++offsets[id_and_value.first];
+        }
+        for (auto id = size; id > 0; --id) {
+            offsets[id] = offsets[id - 1];
+        }
+        offsets[0] = 0;
+    }
+
+    /// append_elements moves the elements past begin (converted from a later occurrence of the list option with the
+    /// given id) to the end of the id's range, and shifts the ranges of the list options stored after it.
+    template <typename Elements, typename Ranges>
+    inline void append_elements(Elements& elements, Ranges& ranges, std::size_t id, std::size_t begin) {
+        const auto position = ranges[id].second;
+        const auto count = elements.size() - begin;
+        if (position != begin) {
+            std::rotate(elements.begin() + position, elements.begin() + begin, elements.end());
+            for (std::size_t other = 0; other < ranges.size(); ++other) {
+                if (other != id && ranges[other].first >= position && ranges[other].second > ranges[other].first) {
+                    ranges[other].first += count;
+                    ranges[other].second += count;
+                }
+            }
+        }
+        ranges[id].second += count;
+    }
+
+    /// basic_command_view contains parsed arguments, options and flags without copying them.
+    /// Options and flags are indexed by the label ids assigned by the parser that created the command_view.
+    /// The slices point to the characters of argv, and to the names stored by the parser.
+    /// A command_view must not outlive argv or the parser that created it.
+    template <typename Allocator>
+    struct basic_command_view {
+        typedef std::vector<slice, rebind_allocator<Allocator, slice>> slices_type;
+        typedef std::vector<bool, rebind_allocator<Allocator, bool>> flags_type;
+        typedef std::vector<std::size_t, rebind_allocator<Allocator, std::size_t>> offsets_type;
+        typedef std::vector<number, rebind_allocator<Allocator, number>> numbers_type;
+        typedef std::pair<std::size_t, std::size_t> range;
+        typedef std::vector<range, rebind_allocator<Allocator, range>> ranges_type;
+
+        /// arguments contains the positionnal arguments given to the program.
+        slices_type arguments;
+
+        /// options contains the parameter of each label.
+        /// The parameter of a flag, or of an option that was not given to the program, has a null data pointer.
+        slices_type options;
+
+        /// flags determines, for each label, whether it is a flag given to the program.
+        flags_type flags;
+
+        /// names points to the name of each label.
+        const slice* names;
+
+        /// values contains every parameter of the repeatable options, grouped by id, in order for each id.
+        slices_type values;
+
+        /// offsets contains, for each id, the index of its first parameter in values, followed by the size of values.
+        /// It is empty if no repeatable option was given to the program.
+        offsets_type offsets;
+
+        /// numbers contains, for each id, the converted parameter of a typed scalar option (see parameter_type).
+        /// It is empty if no typed scalar option was given to the program.
+        numbers_type numbers;
+
+        /// elements contains the converted elements of the list options, grouped by id.
+        /// The elements of every occurrence of a repeatable list option are stored one after the other under its id.
+        numbers_type elements;
+
+        /// ranges contains, for each id, the index of the first element of a list option in elements and the index
+        /// past its last element. It is empty if no list option was given to the program.
+        ranges_type ranges;
+
+        /// integer returns the converted parameter of an integer option (zero if it was not given).
+        int64_t integer(std::size_t id) const {
+            return numbers.empty() ? 0 : numbers[id].integer;
+        }
+
+        /// floating returns the converted parameter of a floating option (zero if it was not given).
+        double floating(std::size_t id) const {
+            return numbers.empty() ? 0.0 : numbers[id].floating;
+        }
+
+        /// choice returns the index of the choice of an enumeration option (zero if it was not given).
+        std::size_t choice(std::size_t id) const {
+            return numbers.empty() ? 0 : static_cast<std::size_t>(numbers[id].integer);
+        }
+
+        /// duration returns the converted parameter of a duration option (zero if it was not given).
+        std::chrono::nanoseconds duration(std::size_t id) const {
+            return std::chrono::nanoseconds(numbers.empty() ? 0 : numbers[id].integer);
+        }
+
+        /// elements_begin returns a pointer to the first element of the list option with the given id.
+        const number* elements_begin(std::size_t id) const {
+            return ranges.empty() ? elements.data() : elements.data() + ranges[id].first;
+        }
+
+        /// elements_end returns a pointer past the last element of the list option with the given id.
+        const number* elements_end(std::size_t id) const {
+            return ranges.empty() ? elements.data() : elements.data() + ranges[id].second;
+        }
+
+        /// values_begin returns a pointer to the first parameter of the repeatable option with the given id.
+        const slice* values_begin(std::size_t id) const {
+            return offsets.empty() ? values.data() : values.data() + offsets[id];
+        }
+
+        /// values_end returns a pointer past the last parameter of the repeatable option with the given id.
+        const slice* values_end(std::size_t id) const {
+            return offsets.empty() ? values.data() : values.data() + offsets[id + 1];
+        }
+
+        /// has_option determines whether the option with the given id was given to the program.
+        bool has_option(std::size_t id) const {
+            return options[id].data != nullptr;
+        }
+
+        /// option returns the parameter of the option with the given name (null data pointer if it was not given).
+        /// It compares the name with each label, and is slower than an access by id.
+        slice option(slice name) const {
+            for (std::size_t id = 0; id < options.size(); ++id) {
+                if (compare(names[id], name) == 0) {
+                    return options[id];
+                }
+            }
+            return slice();
+        }
+
+        /// flag determines whether the flag with the given name was given to the program.
+        /// It compares the name with each label, and is slower than an access by id.
+        bool flag(slice name) const {
+            for (std::size_t id = 0; id < flags.size(); ++id) {
+                if (compare(names[id], name) == 0) {
+                    return flags[id];
+                }
+            }
+            return false;
+        }
+
+        /// to_command copies the arguments, options and flags into an owning command.
+        template <typename CommandAllocator>
+        basic_command<CommandAllocator> to_command(const CommandAllocator& allocator) const {
+            typedef typename basic_command<CommandAllocator>::string string;
+            auto command = make_command(allocator);
+            command.arguments.reserve(arguments.size());
+            for (const auto& argument : arguments) {
+                command.arguments.push_back(string(argument.data, argument.size, allocator));
+            }
+            for (std::size_t id = 0; id < options.size(); ++id) {
+                if (options[id].data != nullptr) {
+                    command.options.insert(std::make_pair(
+                        string(names[id].data, names[id].size, allocator),
+                        string(options[id].data, options[id].size, allocator)));
+                }
+                if (flags[id]) {
+                    command.flags.insert(string(names[id].data, names[id].size, allocator));
+                }
+            }
+            if (!offsets.empty()) {
+                for (std::size_t id = 0; id < options.size(); ++id) {
+                    if (offsets[id] != offsets[id + 1]) {
+                        command.repeated.insert(std::make_pair(
+                            string(names[id].data, names[id].size, allocator),
+                            std::make_pair(offsets[id], offsets[id + 1])));
+                    }
+                }
+                command.ranges.reserve(values.size());
+                for (const auto& value : values) {
+                    command.ranges.push_back(
+                        std::make_pair(command.values.size(), command.values.size() + value.size));
+                    command.values.append(value.data, value.size);
+                }
+            }
+            return command;
+        }
+        command to_command() const {
+            return to_command(std::allocator<char>());
+        }
+    };
+
+    /// command_view contains parsed arguments, options and flags without copying them.
+    typedef basic_command_view<std::allocator<char>> command_view;
+
+    /// match describes the option or flag associated with a name or alias.
+    struct match {
+        /// is_option is false for flags.
+        bool is_option;
+
+        /// id is the index of the label, in declaration order.
+        std::size_t id;
+
+        /// is_repeatable is true for options that collect every parameter.
+        bool is_repeatable;
+
+        /// name is the option or flag name (not the alias).
+        slice name;
+
+        /// type points to the parameter type of a typed option, and is null for string options and flags.
+        const parameter_type* type;
+
+        /// is_ambiguous is set by find when the name or alias is a prefix of several labels' names or aliases (name
+        /// then lists them).
+        bool is_ambiguous;
+    };
+
+    /// is_valid_parameter determines whether the parameter of an option can be converted to its type.
+    inline bool is_valid_parameter(const match& match, slice parameter) {
+        if (match.type == nullptr) {
+            return true;
+        }
+        number value;
+        return is_list(match.type->kind) ? convert_list(*match.type, parameter, [](number) {}) :
+                                           convert(*match.type, parameter, value);
+    }
+
+    /// error_kind lists the problems detected in a command line.
+    enum class error_kind {
+        missing_name,
+        unknown_name,
+        ambiguous_name,
+        missing_parameter,
+        unexpected_parameter,
+        invalid_parameter,
+        too_many_arguments,
+        not_enough_arguments,
+        unknown_subcommand,
+        unterminated_quote,
+        invalid_argument,
+        unreadable_response_file,
+        nested_response_file,
+    };
+
+    /// error describes a problem detected in a command line.
+    struct error {
+        /// kind is the type of problem.
+        error_kind kind;
+
+        /// index is the position of the offending token, starting at 1 for the token that follows the program name
+        /// (without response files, index is the index in argv). For not_enough_arguments, index is the position
+        /// past the last token.
+        std::size_t index;
+
+        /// text is the offending token, or the offending part of the token (a name or alias, or a parameter, or the
+        /// path of a response file).
+        slice text;
+
+        /// name is the option or flag name for parameter errors, the suggested name (or a null slice) for
+        /// unknown_name errors, and the matching names and aliases, separated by "', '", for ambiguous_name errors.
+        slice name;
+
+        /// type points to the parameter type, for invalid_parameter and invalid_argument errors.
+        const parameter_type* type;
+
+        /// number_of_arguments is the expected number of positional arguments.
+        int64_t number_of_arguments;
+    };
+
+    /// describe returns the message of an error, which is also the message of the exception thrown by parse.
+    inline std::string describe(const error& error) {
+        switch (error.kind) {
+            case error_kind::missing_name:
+                return error.text.size == 1 ? "Unexpected character '-' without an associated name or alias" :
+                                              "Unexpected characters '--' without an associated name or alias";
+            case error_kind::unknown_name:
+                return "Unknown option name or alias '" + error.text.to_string() + "'"
+                       + (error.name.data == nullptr ? std::string() :
+                                                       " (did you mean '" + error.name.to_string() + "'?)");
+            case error_kind::ambiguous_name:
+                return "Ambiguous option name or alias '" + error.text.to_string() + "' (it could be '"
+                       + error.name.to_string() + "')";
+            case error_kind::missing_parameter:
+                return "The option '" + error.name.to_string() + "' requires a parameter";
+            case error_kind::unexpected_parameter:
+                return "The flag '" + error.name.to_string() + "' does not take a parameter";
+            case error_kind::invalid_parameter:
+                return "The option '" + error.name.to_string() + "' expects " + describe(*error.type) + " (got '"
+                       + error.text.to_string() + "')";
+            case error_kind::too_many_arguments:
+                return "Too many arguments (" + std::to_string(error.number_of_arguments) + " expected)";
+            case error_kind::not_enough_arguments:
+                return "Not enough arguments (" + std::to_string(error.number_of_arguments) + " expected)";
+            case error_kind::unknown_subcommand:
+                return "Unknown subcommand '" + error.text.to_string() + "'";
+            case error_kind::unterminated_quote:
+                return "Unterminated quote in '" + error.text.to_string() + "'";
+            case error_kind::invalid_argument:
+                return "The argument '" + error.text.to_string() + "' is not " + describe(*error.type);
+            case error_kind::unreadable_response_file:
+                return "The response file '" + error.text.to_string() + "' could not be read";
+            case error_kind::nested_response_file:
+                return "The response file '" + error.text.to_string() + "' is nested too deeply";
+        }
+        return std::string();
+    }
+
+    /// throw_error throws an error as a std::runtime_error.
+    inline void throw_error(const error& error) {
+        throw_exception(std::runtime_error(describe(error)));
+    }
+
+    /// throw_errors throws several errors as a single std::runtime_error, with one message per line.
+    inline void throw_errors(const std::vector<error>& errors) {
+        std::string message;
+        for (const auto& error : errors) {
+            message.append(message.empty() ? "" : "\n").append(describe(error));
+        }
+        throw_exception(std::runtime_error(message));
+    }
+
+    /// outcome contains the result of a parse that does not throw, and the errors detected in the command line.
+    /// The result is complete only if there are no errors. The errors' slices point to the tokens.
+    template <typename Result>
+    struct outcome {
+        Result result;
+        std::vector<error> errors;
+
+        /// operator bool returns true if the command line has no errors.
+        explicit operator bool() const {
+            return errors.empty();
+        }
+    };
+
+    /// argv_tokens reads the elements of argv, skipping the program name.
+    class argv_tokens {
+        public:
+        argv_tokens(int argc, char* argv[]) : _argc(argc), _argv(argv), _index(1) {}
+        argv_tokens(const argv_tokens&) = default;
+        argv_tokens(argv_tokens&&) = default;
+        argv_tokens& operator=(const argv_tokens&) = default;
+        argv_tokens& operator=(argv_tokens&&) = default;
+        ~argv_tokens() {}
+
+        /// next reads the next token, and returns false if there are no more tokens.
+        bool next(slice& token) {
+            if (_index >= _argc) {
+                return false;
+            }
+            token = slice(_argv[_index]);
+            ++_index;
+            return true;
+        }
+
+        /// size_hint returns an estimation of the number of tokens.
+        std::size_t size_hint() const {
+            return _argc > 1 ? static_cast<std::size_t>(_argc - 1) : 0;
+        }
+
+        protected:
+        int _argc;
+        char** _argv;
+        int _index;
+    };
+
+    /// mapped_file gives read-only access to the bytes of a file.
+    /// On POSIX systems, the file is memory-mapped. On other systems, it is read in memory.
+    class mapped_file {
+        public:
+        mapped_file() : _data(nullptr), _size(0) {}
+        mapped_file(const std::string& filename) : mapped_file() {
+            const auto failure = open(filename);
+            if (failure != nullptr) {
+                throw_exception(std::runtime_error("The file '" + filename + "' could not be " + failure));
+            }
+        }
+        mapped_file(const mapped_file&) = delete;
+        mapped_file(mapped_file&&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        mapped_file& operator=(mapped_file&&) = delete;
+        ~mapped_file() {
+#ifdef PONTELLA_MMAP
+            if (_data != nullptr) {
+                ::munmap(const_cast<char*>(_data), _size);
+            }
+#endif
+        }
+
+        /// open maps (or reads) a file in an empty mapped_file, without throwing.
+        /// It returns nullptr, or the step that failed ("opened", "read" or "mapped").
+        const char* open(const std::string& filename) {
+#ifdef PONTELLA_MMAP
+            const auto file_descriptor = ::open(filename.c_str(), O_RDONLY);
+            if (file_descriptor < 0) {
+                return "opened";
+            }
+            struct stat status;
+            if (::fstat(file_descriptor, &status) < 0) {
+                ::close(file_descriptor);
+                return "read";
+            }
+            _size = static_cast<std::size_t>(status.st_size);
+            if (_size > 0) {
+                auto data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+                if (data == MAP_FAILED) {
+                    ::close(file_descriptor);
+                    _size = 0;
+                    return "mapped";
+                }
+                _data = static_cast<const char*>(data);
+            }
+            ::close(file_descriptor);
+#else
+            std::ifstream stream(filename, std::ios::in | std::ios::binary);
+            if (!stream.good()) {
+                return "opened";
+            }
+            _bytes.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+            _data = _bytes.data();
+            _size = _bytes.size();
+#endif
+            return nullptr;
+        }
+
+        /// data returns a pointer to the first byte of the file.
+        const char* data() const {
+            return _data;
+        }
+
+        /// size returns the number of bytes in the file.
+        std::size_t size() const {
+            return _size;
+        }
+
+        protected:
+        const char* _data;
+        std::size_t _size;
+#ifndef PONTELLA_MMAP
+        std::vector<char> _bytes;
+#endif
+    };
+
+    /// is_shell_space determines whether a character separates tokens (the white-space characters of the C locale).
+    inline bool is_shell_space(char character) {
+        return character == ' ' || (character >= '\t' && character <= '\r');
+    }
+
+#ifdef PONTELLA_SSE2
+    /// count_trailing_zeros returns the index of the lowest set bit of a non-zero integer.
+    inline unsigned int count_trailing_zeros(unsigned int bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, bits);
+        return static_cast<unsigned int>(index);
+#else
+        return static_cast<unsigned int>(__builtin_ctz(bits));
+#endif
+    }
+#endif
+
+    /// find_special returns a pointer to the first white-space character, quote or backslash in [begin, end), or end.
+    /// If is_quoted is true (inside double quotes), only double quotes and backslashes are special.
+    /// With SSE2, 16 bytes are compared per iteration, and the remaining bytes one by one.
+    inline const char* find_special(const char* begin, const char* end, bool is_quoted = false) {
+#ifdef PONTELLA_SSE2
+        const auto double_quotes = _mm_set1_epi8('"');
+        const auto backslashes = _mm_set1_epi8('\\');
+        const auto spaces = _mm_set1_epi8(' ');
+        const auto single_quotes = _mm_set1_epi8('\'');
+        const auto tabs = _mm_set1_epi8('\t');
+        const auto fours = _mm_set1_epi8(4);
+        for (; end - begin >= 16; begin += 16) {
+            const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            auto mask = _mm_or_si128(_mm_cmpeq_epi8(bytes, double_quotes), _mm_cmpeq_epi8(bytes, backslashes));
+            if (!is_quoted) {
+                mask = _mm_or_si128(
+                    mask, _mm_or_si128(_mm_cmpeq_epi8(bytes, spaces), _mm_cmpeq_epi8(bytes, single_quotes)));
+                // the characters '\t' to '\r' are the bytes such that byte - '\t' <= 4 (unsigned)
+                const auto shifted = _mm_sub_epi8(bytes, tabs);
+                mask = _mm_or_si128(mask, _mm_cmpeq_epi8(_mm_min_epu8(shifted, fours), shifted));
+            }
+            const auto bits = static_cast<unsigned int>(_mm_movemask_epi8(mask));
+            if (bits != 0) {
+                return begin + count_trailing_zeros(bits);
+            }
+        }
+#endif
+        for (; begin != end; ++begin) {
+            if (*begin == '"' || *begin == '\\' || (!is_quoted && (*begin == '\'' || is_shell_space(*begin)))) {
+                return begin;
+            }
+        }
+        return end;
+    }
+
+    /// shell_tokenizer splits bytes into tokens with the quoting rules of POSIX shells, and is shared by
+    /// response_file_tokens, tokenize_line and incremental_parser. Tokens are separated by white-space characters,
+    /// single quotes preserve every character, double quotes preserve every character but the backslash escapes of
+    /// '$', '`', '"', '\\' and newlines, and a backslash outside quotes escapes the next character. A backslash
+    /// followed by a newline joins lines (inside and outside double quotes), and does not start a token by itself.
+    /// Variables, globs and other expansions are not performed.
+    /// The bytes can be given in several chunks, and a token or a quote can span several chunks.
+    class shell_tokenizer {
+        public:
+        shell_tokenizer() : _is_in_token(false), _is_escaped(false), _quote(0) {}
+        shell_tokenizer(const shell_tokenizer&) = default;
+        shell_tokenizer(shell_tokenizer&&) = default;
+        shell_tokenizer& operator=(const shell_tokenizer&) = default;
+        shell_tokenizer& operator=(shell_tokenizer&&) = default;
+        ~shell_tokenizer() {}
+
+        /// next reads bytes from position until a token is complete, and returns true with the token, or false once
+        /// position reaches end. If is_last is true, end also terminates the current token (unless a quote is open,
+        /// see quote). Raw tokens (is_raw, without quotes or backslashes, within a single chunk) point to the bytes,
+        /// other tokens point to a buffer of the tokenizer, valid until the next call.
+        bool next(const char*& position, const char* end, bool is_last, slice& token, bool& is_raw) {
+            while (position != end) {
+                if (_is_escaped) {
+                    _is_escaped = false;
+                    if (*position != '\n') {
+                        _is_in_token = true;
+                        if (_quote == '"' && *position != '$' && *position != '`' && *position != '"'
+                            && *position != '\\') {
+                            _token.push_back('\\');
+                        }
+                        _token.push_back(*position);
+                    }
+                    ++position;
+                } else if (_quote == '\'') {
+                    const auto quote =
+                        static_cast<const char*>(std::memchr(position, '\'', static_cast<std::size_t>(end - position)));
+                    if (quote == nullptr) {
+                        _token.append(position, end);
+                        position = end;
+                    } else {
+                        _token.append(position, quote);
+                        position = quote + 1;
+                        _quote = 0;
+                    }
+                } else if (_quote == '"') {
+                    const auto special = find_special(position, end, true);
+                    _token.append(position, special);
+                    position = special;
+                    if (position != end) {
+                        if (*position == '"') {
+                            _quote = 0;
+                        } else {
+                            _is_escaped = true;
+                        }
+                        ++position;
+                    }
+                } else if (is_shell_space(*position)) {
+                    ++position;
+                    if (_is_in_token) {
+                        complete(token, is_raw);
+                        return true;
+                    }
+                } else {
+                    const auto begin = position;
+                    position = find_special(position, end);
+                    if (!_is_in_token && (position == end ? is_last : is_shell_space(*position))) {
+                        token = slice(begin, static_cast<std::size_t>(position - begin));
+                        is_raw = true;
+                        return true;
+                    }
+                    _token.append(begin, position);
+                    if (position != begin) {
+                        _is_in_token = true;
+                    }
+                    if (position != end && !is_shell_space(*position)) {
+                        // a backslash does not start a token by itself, since it may join lines
+                        if (*position == '\\') {
+                            _is_escaped = true;
+                        } else {
+                            _quote = *position;
+                            _is_in_token = true;
+                        }
+                        ++position;
+                    }
+                }
+            }
+            if (is_last && _quote == 0) {
+                _is_escaped = false;
+                if (_is_in_token) {
+                    complete(token, is_raw);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// quote returns the open quote character, or 0.
+        char quote() const {
+            return _quote;
+        }
+
+        /// pending returns the unescaped characters of the current token.
+        slice pending() const {
+            return slice(_token);
+        }
+
+        /// reset discards the current token.
+        void reset() {
+            _token.clear();
+            _is_in_token = false;
+            _is_escaped = false;
+            _quote = 0;
+        }
+
+        protected:
+        /// complete moves the current token to the buffer of complete tokens.
+        void complete(slice& token, bool& is_raw) {
+            _completed.swap(_token);
+            _token.clear();
+            _is_in_token = false;
+            token = slice(_completed);
+            is_raw = false;
+        }
+
+        std::string _token;
+        std::string _completed;
+        bool _is_in_token;
+        bool _is_escaped;
+        char _quote;
+    };
+
+    /// response_file_tokens reads the elements of argv, and replaces each element "@path" with the tokens of the
+    /// response file at the given path.
+    /// Response files are mapped in memory and tokenized lazily, with the quoting rules of POSIX shells (see
+    /// shell_tokenizer). An unquoted token "@path" in a response file is expanded as well.
+    /// Tokens without quotes or backslashes point directly to the mapped files, other tokens are unescaped in
+    /// response_file_tokens' storage. The tokens are valid as long as the response_file_tokens object.
+    /// A response file that cannot be read, a response file nested beyond maximum_depth and an unterminated quote are
+    /// reported to the parser (see read_token), and the rest of the offending file is skipped.
+    class response_file_tokens {
+        public:
+        response_file_tokens(int argc, char* argv[], std::size_t maximum_depth = 16) :
+            _argv_tokens(argc, argv),
+            _maximum_depth(maximum_depth) {}
+        response_file_tokens(const response_file_tokens&) = delete;
+        response_file_tokens(response_file_tokens&&) = default;
+        response_file_tokens& operator=(const response_file_tokens&) = delete;
+        response_file_tokens& operator=(response_file_tokens&&) = default;
+        ~response_file_tokens() {}
+
+        /// next reads the next token, and returns false if there are no more tokens.
+        /// report must be compatible with the expression `report(error_kind kind, slice text)`. The overload without
+        /// report throws errors.
+        template <typename Report>
+        bool next(slice& token, Report& report) {
+            for (;;) {
+                if (_stack.empty()) {
+                    if (!_argv_tokens.next(token)) {
+                        return false;
+                    }
+                    if (token.size > 1 && token.data[0] == '@') {
+                        open(slice(token.data + 1, token.size - 1), report);
+                        continue;
+                    }
+                    return true;
+                }
+                auto is_raw = false;
+                if (!read(_stack.back(), token, is_raw, report)) {
+                    _stack.pop_back();
+                    continue;
+                }
+                if (is_raw && token.size > 1 && token.data[0] == '@') {
+                    open(slice(token.data + 1, token.size - 1), report);
+                    continue;
+                }
+                return true;
+            }
+        }
+        bool next(slice& token) {
+            auto report = [](error_kind kind, slice text) {
+                throw_error(error{kind, 0, text, slice(), nullptr, 0});
+            };
+            return next(token, report);
+        }
+
+        /// size_hint returns an estimation of the number of tokens.
+        std::size_t size_hint() const {
+            return _argv_tokens.size_hint();
+        }
+
+        protected:
+        /// cursor is a position in a mapped response file.
+        struct cursor {
+            const char* position;
+            const char* end;
+        };
+
+        /// open maps a response file and pushes it on the stack.
+        template <typename Report>
+        void open(slice filename, Report& report) {
+            if (_stack.size() >= _maximum_depth) {
+                report(error_kind::nested_response_file, filename);
+                return;
+            }
+            std::unique_ptr<mapped_file> file(new mapped_file());
+            if (file->open(filename.to_string()) != nullptr) {
+                report(error_kind::unreadable_response_file, filename);
+                return;
+            }
+            _files.push_back(std::move(file));
+            _stack.push_back({_files.back()->data(), _files.back()->data() + _files.back()->size()});
+        }
+
+        /// read extracts the next token of a response file.
+        /// is_raw is true if the token has neither quotes nor backslashes.
+        template <typename Report>
+        bool read(cursor& cursor, slice& token, bool& is_raw, Report& report) {
+            auto token_begin = cursor.position;
+            if (!_tokenizer.next(cursor.position, cursor.end, true, token, is_raw)) {
+                if (_tokenizer.quote() != 0) {
+                    _tokenizer.reset();
+                    while (is_shell_space(*token_begin)) {
+                        ++token_begin;
+                    }
+                    report(
+                        error_kind::unterminated_quote,
+                        slice(token_begin, static_cast<std::size_t>(cursor.end - token_begin)));
+                }
+                return false;
+            }
+            if (!is_raw) {
+                _unescaped.emplace_back(token.data, token.size);
+                token = slice(_unescaped.back());
+            }
+            return true;
+        }
+
+        argv_tokens _argv_tokens;
+        shell_tokenizer _tokenizer;
+        std::size_t _maximum_depth;
+        std::vector<std::unique_ptr<mapped_file>> _files;
+        std::vector<cursor> _stack;
+        std::deque<std::string> _unescaped;
+    };
+
+    /// tokenize_line splits a line into tokens with the quoting rules of POSIX shells (see shell_tokenizer).
+    /// Tokens without quotes or backslashes point to the line, other tokens are unescaped in storage.
+    /// If a quote is not closed, tokenize_line sets unterminated to the last token (up to the end of the line), and
+    /// returns false.
+    inline bool
+    tokenize_line(slice line, std::vector<slice>& tokens, std::deque<std::string>& storage, slice& unterminated) {
+        shell_tokenizer tokenizer;
+        auto position = line.data;
+        const auto end = line.data + line.size;
+        auto token_begin = position;
+        slice token;
+        auto is_raw = false;
+        while (tokenizer.next(position, end, true, token, is_raw)) {
+            if (is_raw) {
+                tokens.push_back(token);
+            } else {
+                storage.emplace_back(token.data, token.size);
+                tokens.emplace_back(storage.back());
+            }
+            token_begin = position;
+        }
+        if (tokenizer.quote() != 0) {
+            while (is_shell_space(*token_begin)) {
+                ++token_begin;
+            }
+            unterminated = slice(token_begin, static_cast<std::size_t>(end - token_begin));
+            return false;
+        }
+        return true;
+    }
+
+    /// slice_tokens reads the elements of an array of slices.
+    class slice_tokens {
+        public:
+        slice_tokens(const slice* begin, const slice* end) : _position(begin), _end(end) {}
+        slice_tokens(const slice_tokens&) = default;
+        slice_tokens(slice_tokens&&) = default;
+        slice_tokens& operator=(const slice_tokens&) = default;
+        slice_tokens& operator=(slice_tokens&&) = default;
+        ~slice_tokens() {}
+
+        /// next reads the next token, and returns false if there are no more tokens.
+        bool next(slice& token) {
+            if (_position == _end) {
+                return false;
+            }
+            token = *_position;
+            ++_position;
+            return true;
+        }
+
+        /// size_hint returns an estimation of the number of tokens.
+        std::size_t size_hint() const {
+            return static_cast<std::size_t>(_end - _position);
+        }
+
+        protected:
+        const slice* _position;
+        const slice* _end;
+    };
+
+    /// phase lists the steps reported to observers.
+    enum class phase {
+        /// validation checks the names, aliases and types of the labels (parser construction).
+        validation,
+
+        /// construction sorts the names and aliases, and builds the lookup tables (parser construction).
+        construction,
+
+        /// tokenization reads the next token from the tokens object (parsing).
+        tokenization,
+
+        /// lookup retrieves the label associated with a name or alias (parsing).
+        lookup,
+    };
+
+    /// null_observer is the default observer, and does nothing. Calls to its methods are removed by the compiler.
+    /// Observers must implement the same methods, and are not shared by several threads unless they synchronize.
+    struct null_observer {
+        /// begin and end are called around each phase.
+        void begin(phase) {}
+        void end(phase) {}
+
+        /// token is called with each token read while parsing.
+        void token(slice) {}
+
+        /// lookup is called with each name or alias looked up, and the result.
+        void lookup(slice, const match&, bool) {}
+
+        /// allocation is called by observed_allocator with the size in bytes of each allocation.
+        /// Only the allocations of the parsed command (made with an observed_allocator) are reported. The tables built
+        /// by the parser constructor and the temporaries of parsing (for example the error vectors of try_parse) use
+        /// the default allocator, and are not reported.
+        void allocation(std::size_t) {}
+    };
+
+    /// statistics is an observer that measures the time spent in each phase, and counts events.
+    /// allocations and allocated_bytes only cover the allocations reported by observed_allocator (see null_observer).
+    /// trace, if set, is called with each token.
+    struct statistics {
+        std::chrono::nanoseconds durations[4];
+        std::size_t tokens;
+        std::size_t lookups;
+        std::size_t misses;
+        std::size_t allocations;
+        std::size_t allocated_bytes;
+        std::function<void(slice)> trace;
+
+        statistics() : tokens(0), lookups(0), misses(0), allocations(0), allocated_bytes(0) {
+            for (auto& duration : durations) {
+                duration = std::chrono::nanoseconds(0);
+            }
+        }
+
+        /// duration returns the total time spent in the given phase.
+        std::chrono::nanoseconds duration(phase target) const {
+            return durations[static_cast<std::size_t>(target)];
+        }
+
+        void begin(phase) {
+            _begin = std::chrono::steady_clock::now();
+        }
+        void end(phase target) {
+            durations[static_cast<std::size_t>(target)] +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _begin);
+        }
+        void token(slice token) {
+            ++tokens;
+            if (trace) {
+                trace(token);
+            }
+        }
+        void lookup(slice, const match&, bool is_found) {
+            ++lookups;
+            if (!is_found) {
+                ++misses;
+            }
+        }
+        void allocation(std::size_t size) {
+            ++allocations;
+            allocated_bytes += size;
+        }
+
+        protected:
+        std::chrono::steady_clock::time_point _begin;
+    };
+
+    /// observed_tokens wraps a tokens object, and reports the tokenization phase and each token to an observer.
+    template <typename Tokens, typename Observer>
+    class observed_tokens {
+        public:
+        observed_tokens(Tokens& tokens, Observer& observer) : _tokens(&tokens), _observer(&observer) {}
+        observed_tokens(const observed_tokens&) = default;
+        observed_tokens(observed_tokens&&) = default;
+        observed_tokens& operator=(const observed_tokens&) = default;
+        observed_tokens& operator=(observed_tokens&&) = default;
+        ~observed_tokens() {}
+
+        /// next reads the next token, and returns false if there are no more tokens.
+        bool next(slice& token) {
+            _observer->begin(phase::tokenization);
+            const auto has_token = _tokens->next(token);
+            _observer->end(phase::tokenization);
+            if (has_token) {
+                _observer->token(token);
+            }
+            return has_token;
+        }
+        template <typename Report>
+        auto next(slice& token, Report& report) -> decltype(std::declval<Tokens&>().next(token, report)) {
+            _observer->begin(phase::tokenization);
+            const auto has_token = _tokens->next(token, report);
+            _observer->end(phase::tokenization);
+            if (has_token) {
+                _observer->token(token);
+            }
+            return has_token;
+        }
+
+        /// size_hint returns an estimation of the number of tokens.
+        std::size_t size_hint() const {
+            return _tokens->size_hint();
+        }
+
+        protected:
+        Tokens* _tokens;
+        Observer* _observer;
+    };
+
+    /// observed_allocator is a standard allocator that reports each allocation to an observer.
+    template <typename Type, typename Observer>
+    class observed_allocator {
+        public:
+        template <typename OtherType, typename OtherObserver>
+        friend class observed_allocator;
+        typedef Type value_type;
+        observed_allocator(Observer& observer) : _observer(&observer) {}
+        template <typename OtherType>
+        observed_allocator(const observed_allocator<OtherType, Observer>& other) : _observer(other._observer) {}
+        observed_allocator(const observed_allocator&) = default;
+        observed_allocator(observed_allocator&&) = default;
+        observed_allocator& operator=(const observed_allocator&) = default;
+        observed_allocator& operator=(observed_allocator&&) = default;
+        ~observed_allocator() {}
+
+        /// allocate reserves memory for size objects.
+        Type* allocate(std::size_t size) {
+            _observer->allocation(size * sizeof(Type));
+            return std::allocator<Type>().allocate(size);
+        }
+
+        /// deallocate releases memory reserved by allocate.
+        void deallocate(Type* pointer, std::size_t size) {
+            std::allocator<Type>().deallocate(pointer, size);
+        }
+
+        template <typename OtherType>
+        bool operator==(const observed_allocator<OtherType, Observer>& other) const {
+            return _observer == other._observer;
+        }
+        template <typename OtherType>
+        bool operator!=(const observed_allocator<OtherType, Observer>& other) const {
+            return _observer != other._observer;
+        }
+
+        protected:
+        Observer* _observer;
+    };
+
+    /// is_parallel_worker returns a reference to a flag set while the current thread runs tasks for parallel_for.
+    inline bool& is_parallel_worker() {
+        static thread_local bool is_worker = false;
+        return is_worker;
+    }
+
+    /// parallel_for calls task(index) for each index in [0, size), on at most number_of_threads threads (including the
+    /// calling thread). If number_of_threads is 0, the number of hardware threads is used.
+    /// Each thread starts with a contiguous range of indices, and steals half of the remaining range of another
+    /// thread when its own range is empty. task must be safe to call concurrently with different indices.
+    /// A parallel_for called by a task (for example a path check in a spool line) runs on the calling thread, so
+    /// that nested loops do not multiply the number of threads.
+    /// The first exception thrown by a task is rethrown once every thread has returned.
+    template <typename Task>
+    inline void parallel_for(std::size_t size, std::size_t number_of_threads, Task task) {
+        if (number_of_threads == 0) {
+            number_of_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        number_of_threads = std::min(number_of_threads, size);
+        if (number_of_threads <= 1 || is_parallel_worker()) {
+            for (std::size_t index = 0; index < size; ++index) {
+                task(index);
+            }
+            return;
+        }
+        struct work_range {
+            std::mutex mutex;
+            std::size_t begin;
+            std::size_t end;
+        };
+        std::unique_ptr<work_range[]> ranges(new work_range[number_of_threads]);
+        for (std::size_t thread_index = 0; thread_index < number_of_threads; ++thread_index) {
+            ranges[thread_index].begin = size * thread_index / number_of_threads;
+            ranges[thread_index].end = size * (thread_index + 1) / number_of_threads;
+        }
+#ifdef PONTELLA_EXCEPTIONS
+        std::mutex exception_mutex;
+        std::exception_ptr exception;
+#endif
+        const auto work = [&](std::size_t thread_index) {
+            is_parallel_worker() = true;
+            auto& own = ranges[thread_index];
+            for (;;) {
+                auto index = size;
+                {
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    if (own.begin < own.end) {
+                        index = own.begin;
+                        ++own.begin;
+                    }
+                }
+                for (std::size_t offset = 1; index == size && offset < number_of_threads; ++offset) {
+                    auto& victim = ranges[(thread_index + offset) % number_of_threads];
+                    std::size_t begin = 0;
+                    std::size_t end = 0;
+                    {
+                        std::lock_guard<std::mutex> lock(victim.mutex);
+                        if (victim.begin < victim.end) {
+                            begin = victim.end - (victim.end - victim.begin + 1) / 2;
+                            end = victim.end;
+                            victim.end = begin;
+                        }
+                    }
+                    if (begin < end) {
+                        index = begin;
+                        std::lock_guard<std::mutex> lock(own.mutex);
+                        own.begin = begin + 1;
+                        own.end = end;
+                    }
+                }
+                if (index == size) {
+                    return;
+                }
+#ifdef PONTELLA_EXCEPTIONS
+                try {
+                    task(index);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(exception_mutex);
+                    if (!exception) {
+                        exception = std::current_exception();
+                    }
+                }
+#else
+                task(index);
+#endif
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(number_of_threads - 1);
+        for (std::size_t thread_index = 1; thread_index < number_of_threads; ++thread_index) {
+            threads.emplace_back(work, thread_index);
+        }
+        work(0);
+        is_parallel_worker() = false;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+#ifdef PONTELLA_EXCEPTIONS
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+#endif
+    }
+
+    /// stat_path determines whether a path exists, and whether it is a regular file or a directory.
+    /// On systems that are neither POSIX nor Windows, a path exists if it can be opened, and is then a regular file.
+    inline bool stat_path(const std::string& path, bool& is_file, bool& is_directory) {
+#if defined(PONTELLA_MMAP)
+        struct stat status;
+        if (::stat(path.c_str(), &status) != 0) {
+            return false;
+        }
+        is_file = S_ISREG(status.st_mode);
+        is_directory = S_ISDIR(status.st_mode);
+        return true;
+#elif defined(_WIN32)
+        struct _stat64 status;
+        if (::_stat64(path.c_str(), &status) != 0) {
+            return false;
+        }
+        is_file = (status.st_mode & _S_IFMT) == _S_IFREG;
+        is_directory = (status.st_mode & _S_IFMT) == _S_IFDIR;
+        return true;
+#else
+        is_file = std::ifstream(path).good();
+        is_directory = false;
+        return is_file;
+#endif
+    }
+
+    /// is_readable_path determines whether the current user can read a path.
+    inline bool is_readable_path(const std::string& path) {
+#if defined(PONTELLA_MMAP)
+        return ::access(path.c_str(), R_OK) == 0;
+#elif defined(_WIN32)
+        return ::_access(path.c_str(), 4) == 0;
+#else
+        return std::ifstream(path).good();
+#endif
+    }
+
+    /// parent_path returns the directory that contains a path ("." for a relative path without separators).
+    /// On Windows, backslashes are separators as well, and the parent of "C:\file" is "C:\".
+    inline std::string parent_path(const std::string& path) {
+#ifdef _WIN32
+        const auto separator = path.find_last_of("/\\");
+        if (separator != std::string::npos && separator > 0 && path[separator - 1] == ':') {
+            return path.substr(0, separator + 1);
+        }
+#else
+        const auto separator = path.find_last_of('/');
+#endif
+        if (separator == std::string::npos) {
+            return ".";
+        }
+        return path.substr(0, separator == 0 ? 1 : separator);
+    }
+
+    /// check_path determines whether a path satisfies the constraints of a path type.
+    inline bool check_path(const parameter_type& type, const std::string& path) {
+        const auto constraints = type.path_constraints;
+        if ((constraints & (path_exists | path_is_file | path_is_directory | path_is_readable)) != 0) {
+            auto is_file = false;
+            auto is_directory = false;
+            if (!stat_path(path, is_file, is_directory) || ((constraints & path_is_file) != 0 && !is_file)
+                || ((constraints & path_is_directory) != 0 && !is_directory)
+                || ((constraints & path_is_readable) != 0 && !is_readable_path(path))) {
+                return false;
+            }
+        }
+        if ((constraints & path_parent_exists) != 0) {
+            auto is_file = false;
+            auto is_directory = false;
+            if (!stat_path(parent_path(path), is_file, is_directory) || !is_directory) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// path_entry is a path registered by path_checker, at the given token index.
+    /// name is the option name, or a null slice for arguments.
+    struct path_entry {
+        std::size_t index;
+        slice path;
+        slice name;
+        const parameter_type* type;
+    };
+
+    /// minimum_parallel_paths is the number of paths below which check_path_entries checks paths on the calling
+    /// thread, since starting threads costs more than a few local checks.
+    const std::size_t minimum_parallel_paths = 32;
+
+    /// check_path_entries queries the filesystem for each entry, concurrently with at most number_of_threads threads.
+    /// Waiting on the filesystem (for example, a network file system) dominates the cost of a check, hence the number
+    /// of threads can exceed the number of cores.
+    inline void check_path_entries(
+        const path_entry* entries,
+        std::size_t size,
+        uint8_t* is_valid,
+        std::size_t number_of_threads) {
+        parallel_for(size, size < minimum_parallel_paths ? 1 : number_of_threads, [&](std::size_t index) {
+            is_valid[index] = check_path(*entries[index].type, entries[index].path.to_string()) ? 1 : 0;
+        });
+    }
+
+    /// path_checker collects the path parameters and arguments of a command line, and checks them once the command
+    /// line is parsed, with the check_paths function of the path types (see check_path_entries).
+    /// arguments_type, if not null, is the path type of the positional arguments.
+    class path_checker {
+        public:
+        path_checker(const parameter_type* arguments_type, std::size_t number_of_threads, path_check check_paths) :
+            _arguments_type(arguments_type),
+            _number_of_threads(number_of_threads),
+            _check_paths(check_paths) {}
+        path_checker(const path_checker&) = default;
+        path_checker(path_checker&&) = default;
+        path_checker& operator=(const path_checker&) = default;
+        path_checker& operator=(path_checker&&) = default;
+        ~path_checker() {}
+
+        /// arguments_type returns the type of the positional arguments, or nullptr if they are not paths.
+        const parameter_type* arguments_type() const {
+            return _arguments_type;
+        }
+
+        /// add registers a path, at the given token index. name is the option name, or a null slice for arguments.
+        /// The path must remain valid until check returns.
+        void add(std::size_t index, slice path, slice name, const parameter_type& type) {
+            _entries.push_back(path_entry{index, path, name, &type});
+        }
+
+        /// check queries the filesystem for every registered path, and calls handle_error with each failing path,
+        /// in the order of the command line.
+        template <typename HandleError>
+        void check(int64_t number_of_arguments, HandleError handle_error) {
+            if (_entries.empty()) {
+                return;
+            }
+            std::vector<uint8_t> is_valid(_entries.size(), 0);
+            _check_paths(_entries.data(), _entries.size(), is_valid.data(), _number_of_threads);
+            for (std::size_t index = 0; index < _entries.size(); ++index) {
+                if (is_valid[index] == 0) {
+                    const auto& entry = _entries[index];
+                    handle_error(error{
+                        entry.name.data == nullptr ? error_kind::invalid_argument : error_kind::invalid_parameter,
+                        entry.index,
+                        entry.path,
+                        entry.name,
+                        entry.type,
+                        number_of_arguments});
+                }
+            }
+            _entries.clear();
+        }
+
+        protected:
+        const parameter_type* _arguments_type;
+        std::size_t _number_of_threads;
+        path_check _check_paths;
+        std::vector<path_entry> _entries;
+    };
+
+    /// token_state is the state of the command line grammar between two tokens (see parse_token).
+    struct token_state {
+        /// index is the position of the last token, starting at 1.
+        std::size_t index;
+
+        /// arguments_count is the number of positional arguments read so far.
+        int64_t arguments_count;
+
+        /// is_awaiting_parameter is true if the last token is an option without "=", whose parameter is the next token.
+        bool is_awaiting_parameter;
+
+        /// option and option_token are the option awaiting its parameter and its token.
+        match option;
+        slice option_token;
+
+        token_state() : index(0), arguments_count(0), is_awaiting_parameter(false), option() {}
+    };
+
+    /// parse_token reads one token, updates the state, and calls the handlers (see parse_tokens).
+    /// An option without "=" is handled with the next token, its parameter.
+    template <
+        typename Find,
+        typename HandleArgument,
+        typename HandleOption,
+        typename HandleFlag,
+        typename HandleError>
+    inline void parse_token(
+        token_state& state,
+        slice element,
+        int64_t number_of_arguments,
+        Find& find,
+        HandleArgument& handle_argument,
+        HandleOption& handle_option,
+        HandleFlag& handle_flag,
+        HandleError& handle_error) {
+        ++state.index;
+        if (state.is_awaiting_parameter) {
+            state.is_awaiting_parameter = false;
+            if (!handle_option(static_cast<const match&>(state.option), element)) {
+                handle_error(error{
+                    error_kind::invalid_parameter,
+                    state.index,
+                    element,
+                    state.option.name,
+                    state.option.type,
+                    number_of_arguments});
+            }
+            return;
+        }
+        if (element.size > 0 && element.data[0] == '-') {
+            if (element.size == 1 || (element.size == 2 && element.data[1] == '-')) {
+                handle_error(
+                    error{error_kind::missing_name, state.index, element, slice(), nullptr, number_of_arguments});
+                return;
+            }
+            const auto name_or_alias_and_parameter = element.data[1] == '-' ?
+                                                         slice(element.data + 2, element.size - 2) :
+                                                         slice(element.data + 1, element.size - 1);
+            const auto name_or_alias_end = std::find(
+                name_or_alias_and_parameter.data,
+                name_or_alias_and_parameter.data + name_or_alias_and_parameter.size,
+                '=');
+            const auto has_equal =
+                name_or_alias_end != name_or_alias_and_parameter.data + name_or_alias_and_parameter.size;
+            const slice name_or_alias(
+                name_or_alias_and_parameter.data,
+                static_cast<std::size_t>(name_or_alias_end - name_or_alias_and_parameter.data));
+            match match{};
+            if (!find(name_or_alias, match)) {
+                handle_error(error{
+                    match.is_ambiguous ? error_kind::ambiguous_name : error_kind::unknown_name,
+                    state.index,
+                    name_or_alias,
+                    match.name,
+                    nullptr,
+                    number_of_arguments});
+                return;
+            }
+            if (match.is_option) {
+                if (!has_equal) {
+                    state.is_awaiting_parameter = true;
+                    state.option = match;
+                    state.option_token = element;
+                    return;
+                }
+                const auto parameter_size = name_or_alias_and_parameter.size - name_or_alias.size - 1;
+                const slice parameter(name_or_alias_end + 1, parameter_size);
+                if (!handle_option(static_cast<const pontella::match&>(match), parameter)) {
+                    handle_error(error{
+                        error_kind::invalid_parameter,
+                        state.index,
+                        parameter,
+                        match.name,
+                        match.type,
+                        number_of_arguments});
+                }
+            } else {
+                if (has_equal) {
+                    handle_error(error{
+                        error_kind::unexpected_parameter,
+                        state.index,
+                        element,
+                        match.name,
+                        nullptr,
+                        number_of_arguments});
+                    return;
+                }
+                handle_flag(static_cast<const pontella::match&>(match));
+            }
+        } else {
+            if (number_of_arguments >= 0 && state.arguments_count >= number_of_arguments) {
+                handle_error(
+                    error{error_kind::too_many_arguments, state.index, element, slice(), nullptr, number_of_arguments});
+                return;
+            }
+            ++state.arguments_count;
+            handle_argument(element);
+        }
+    }
+
+    /// finish_tokens reports the errors detected at the end of the command line (a missing parameter, and not enough
+    /// arguments).
+    template <typename HandleError>
+    inline void finish_tokens(const token_state& state, int64_t number_of_arguments, HandleError& handle_error) {
+        if (state.is_awaiting_parameter) {
+            handle_error(error{
+                error_kind::missing_parameter,
+                state.index,
+                state.option_token,
+                state.option.name,
+                nullptr,
+                number_of_arguments});
+        }
+        if (number_of_arguments >= 0 && state.arguments_count < number_of_arguments) {
+            handle_error(error{
+                error_kind::not_enough_arguments, state.index + 1, slice(), slice(), nullptr, number_of_arguments});
+        }
+    }
+
+    /// read_token calls tokens.next(token, report) if tokens reports its own errors (for example
+    /// response_file_tokens), and tokens.next(token) otherwise.
+    template <typename Tokens, typename Report>
+    inline auto read_token(Tokens& tokens, slice& token, Report& report, int)
+        -> decltype(tokens.next(token, report)) {
+        return tokens.next(token, report);
+    }
+    template <typename Tokens, typename Report>
+    inline bool read_token(Tokens& tokens, slice& token, Report&, long) {
+        return tokens.next(token);
+    }
+
+    /// parse_tokens reads tokens, and calls the handlers for each positional argument, option and flag.
+    /// tokens must be compatible with the expression `bool has_token = tokens.next(slice& token)`, or with the
+    /// expression `bool has_token = tokens.next(slice& token, report)` to report errors with
+    /// `report(error_kind kind, slice text)` (the error's index is the index of the next token).
+    /// find must be compatible with the expression `bool found = find(slice name_or_alias, match& match)`, and can set
+    /// match.name to a suggested name when it returns false (or to the matching names, with match.is_ambiguous).
+    /// The handlers must be compatible with the expressions `handle_argument(slice argument)`,
+    /// `bool is_valid = handle_option(const match& match, slice parameter)`, `handle_flag(const match& match)` and
+    /// `handle_error(const error& error)`. handle_option returns false if the parameter cannot be converted.
+    /// If handle_error returns, parsing continues with the next token, so that every error is reported.
+    /// The handlers can read state.index, the index of the current token.
+    template <
+        typename Tokens,
+        typename Find,
+        typename HandleArgument,
+        typename HandleOption,
+        typename HandleFlag,
+        typename HandleError>
+    inline void parse_tokens(
+        Tokens& tokens,
+        int64_t number_of_arguments,
+        Find find,
+        HandleArgument handle_argument,
+        HandleOption handle_option,
+        HandleFlag handle_flag,
+        HandleError handle_error,
+        token_state& state) {
+        slice element;
+        auto report = [&](error_kind kind, slice text) {
+            handle_error(error{kind, state.index + 1, text, slice(), nullptr, number_of_arguments});
+        };
+        while (read_token(tokens, element, report, 0)) {
+            parse_token(
+                state, element, number_of_arguments, find, handle_argument, handle_option, handle_flag, handle_error);
+        }
+        finish_tokens(state, number_of_arguments, handle_error);
+    }
+    template <
+        typename Tokens,
+        typename Find,
+        typename HandleArgument,
+        typename HandleOption,
+        typename HandleFlag,
+        typename HandleError>
+    inline void parse_tokens(
+        Tokens& tokens,
+        int64_t number_of_arguments,
+        Find find,
+        HandleArgument handle_argument,
+        HandleOption handle_option,
+        HandleFlag handle_flag,
+        HandleError handle_error) {
+        token_state state;
+        parse_tokens(
+            tokens, number_of_arguments, find, handle_argument, handle_option, handle_flag, handle_error, state);
+    }
+
+    /// parse_command calls parse_tokens and copies the arguments, options and flags in a command.
+    /// names must point to the name of each label, and size is the number of labels.
+    /// If checker is not null, path parameters (and arguments, if checker has an arguments type) are added to it.
+    template <typename Tokens, typename Find, typename Allocator, typename HandleError>
+    inline basic_command<Allocator> parse_command(
+        Tokens& tokens,
+        int64_t number_of_arguments,
+        Find find,
+        const slice* names,
+        std::size_t size,
+        const Allocator& allocator,
+        HandleError handle_error,
+        path_checker* checker = nullptr) {
+        typedef typename basic_command<Allocator>::string string;
+        typedef typename basic_command<Allocator>::range range;
+        auto command = make_command(allocator);
+        std::vector<std::pair<std::size_t, range>, rebind_allocator<Allocator, std::pair<std::size_t, range>>>
+            ids_and_ranges(allocator);
+        token_state state;
+        parse_tokens(
+            tokens,
+            number_of_arguments,
+            find,
+            [&](slice argument) {
+                if (checker != nullptr && checker->arguments_type() != nullptr) {
+                    checker->add(state.index, argument, slice(), *checker->arguments_type());
+                }
+                command.arguments.push_back(string(argument.data, argument.size, allocator));
+            },
+            [&](const match& match, slice parameter) {
+                if (!is_valid_parameter(match, parameter)) {
+                    return false;
+                }
+                if (checker != nullptr && match.type != nullptr && match.type->kind == parameter_kind::path) {
+                    checker->add(state.index, parameter, match.name, *match.type);
+                }
+                if (match.is_repeatable) {
+                    if (ids_and_ranges.empty()) {
+                        ids_and_ranges.reserve(tokens.size_hint());
+                    }
+                    const auto begin = command.values.size();
+                    command.values.append(parameter.data, parameter.size);
+                    ids_and_ranges.push_back(std::make_pair(match.id, range(begin, command.values.size())));
+                }
+                command.options.insert(std::make_pair(
+                    string(match.name.data, match.name.size, allocator),
+                    string(parameter.data, parameter.size, allocator)));
+                return true;
+            },
+            [&](const match& match) { command.flags.insert(string(match.name.data, match.name.size, allocator)); },
+            handle_error,
+            state);
+        if (!ids_and_ranges.empty()) {
+            std::vector<std::size_t, rebind_allocator<Allocator, std::size_t>> offsets(allocator);
+            group_by_id(ids_and_ranges, size, offsets, command.ranges);
+            for (std::size_t id = 0; id < size; ++id) {
+                if (offsets[id] != offsets[id + 1]) {
+                    command.repeated.insert(std::make_pair(
+                        string(names[id].data, names[id].size, allocator), range(offsets[id], offsets[id + 1])));
+                }
+            }
+        }
+        return command;
+    }
+
+    /// parse_command_view calls parse_tokens and stores references to the arguments, options and flags.
+    /// names must point to the name of each label, and size is the number of labels.
+    /// If checker is not null, path parameters (and arguments, if checker has an arguments type) are added to it.
+    template <typename Tokens, typename Find, typename Allocator, typename HandleError>
+    inline basic_command_view<Allocator> parse_command_view(
+        Tokens& tokens,
+        int64_t number_of_arguments,
+        Find find,
+        const slice* names,
+        std::size_t size,
+        const Allocator& allocator,
+        HandleError handle_error,
+        path_checker* checker = nullptr) {
+        typedef basic_command_view<Allocator> command_view_type;
+        command_view_type command_view{
+            typename command_view_type::slices_type(allocator),
+            typename command_view_type::slices_type(size, slice(), allocator),
+            typename command_view_type::flags_type(size, false, allocator),
+            names,
+            typename command_view_type::slices_type(allocator),
+            typename command_view_type::offsets_type(allocator),
+            typename command_view_type::numbers_type(allocator),
+            typename command_view_type::numbers_type(allocator),
+            typename command_view_type::ranges_type(allocator)};
+        command_view.arguments.reserve(tokens.size_hint());
+        std::vector<std::pair<std::size_t, slice>, rebind_allocator<Allocator, std::pair<std::size_t, slice>>>
+            ids_and_values(allocator);
+        token_state state;
+        parse_tokens(
+            tokens,
+            number_of_arguments,
+            find,
+            [&](slice argument) {
+                if (checker != nullptr && checker->arguments_type() != nullptr) {
+                    checker->add(state.index, argument, slice(), *checker->arguments_type());
+                }
+                command_view.arguments.push_back(argument);
+            },
+            [&](const match& match, slice parameter) {
+                if (checker != nullptr && match.type != nullptr && match.type->kind == parameter_kind::path) {
+                    checker->add(state.index, parameter, match.name, *match.type);
+                }
+                const auto is_first = command_view.options[match.id].data == nullptr;
+                if (match.type != nullptr) {
+                    if (is_list(match.type->kind)) {
+                        if (command_view.ranges.empty()) {
+                            command_view.ranges.resize(size, std::make_pair(0, 0));
+                        }
+                        const auto begin = command_view.elements.size();
+                        const auto commas = std::count(parameter.data, parameter.data + parameter.size, ',');
+                        command_view.elements.reserve(begin + 1 + static_cast<std::size_t>(commas));
+                        if (!convert_list(*match.type, parameter, [&](number value) {
+                                command_view.elements.push_back(value);
+                            })) {
+                            command_view.elements.resize(begin);
+                            return false;
+                        }
+                        if (is_first) {
+                            command_view.ranges[match.id] = std::make_pair(begin, command_view.elements.size());
+                        } else {
+                            append_elements(command_view.elements, command_view.ranges, match.id, begin);
+                        }
+                    } else if (!is_first) {
+                        if (!is_valid_parameter(match, parameter)) {
+                            return false;
+                        }
+                    } else {
+                        number value;
+                        if (!convert(*match.type, parameter, value)) {
+                            return false;
+                        }
+                        if (command_view.numbers.empty()) {
+                            command_view.numbers.resize(size, number());
+                        }
+                        command_view.numbers[match.id] = value;
+                    }
+                }
+                if (is_first) {
+                    command_view.options[match.id] = parameter;
+                }
+                if (match.is_repeatable) {
+                    if (ids_and_values.empty()) {
+                        ids_and_values.reserve(tokens.size_hint());
+                    }
+                    ids_and_values.push_back(std::make_pair(match.id, parameter));
+                }
+                return true;
+            },
+            [&](const match& match) { command_view.flags[match.id] = true; },
+            handle_error,
+            state);
+        if (!ids_and_values.empty()) {
+            group_by_id(ids_and_values, size, command_view.offsets, command_view.values);
+        }
+        return command_view;
+    }
+
+    /// incremental_parser is a push-style variant of visit, for command lines that arrive piece by piece.
+    /// Tokens (or raw bytes) are given one at a time, and the handlers are called as soon as each element is
+    /// complete. Only the option awaiting its parameter and the token being read from bytes are buffered.
+    /// The handlers must be compatible with the expressions `handle_argument(slice argument)`,
+    /// `handle_option(const match& match, slice parameter)`, `handle_flag(const match& match)` and
+    /// `handle_error(const error& error)`. Typed parameters are checked, and invalid ones are reported as errors.
+    /// The slices given to the handlers are valid only during the call.
+    template <
+        typename Parser,
+        typename HandleArgument,
+        typename HandleOption,
+        typename HandleFlag,
+        typename HandleError>
+    class incremental_parser {
+        public:
+        incremental_parser(
+            const Parser& parser,
+            HandleArgument handle_argument,
+            HandleOption handle_option,
+            HandleFlag handle_flag,
+            HandleError handle_error) :
+            _parser(&parser),
+            _handle_argument(handle_argument),
+            _handle_option(handle_option),
+            _handle_flag(handle_flag),
+            _handle_error(handle_error) {}
+        incremental_parser(const incremental_parser&) = delete;
+        incremental_parser(incremental_parser&&) = default;
+        incremental_parser& operator=(const incremental_parser&) = delete;
+        incremental_parser& operator=(incremental_parser&&) = default;
+        ~incremental_parser() {}
+
+        /// push reads a token.
+        void push(slice token) {
+            const auto parser = _parser;
+            auto find = [parser](slice name_or_alias, match& match) { return parser->find(name_or_alias, match); };
+            auto& handle_option = _handle_option;
+            auto check_and_handle_option = [&](const match& match, slice parameter) {
+                if (!is_valid_parameter(match, parameter)) {
+                    return false;
+                }
+                handle_option(match, parameter);
+                return true;
+            };
+            parse_token(
+                _state,
+                token,
+                _parser->number_of_arguments(),
+                find,
+                _handle_argument,
+                check_and_handle_option,
+                _handle_flag,
+                _handle_error);
+            if (_state.is_awaiting_parameter) {
+                _option_token.assign(token.data, token.size);
+            }
+        }
+
+        /// push_bytes reads raw bytes, split into tokens with the quoting rules of POSIX shells (see shell_tokenizer,
+        /// newlines are white-space characters). A token is pushed once the white-space character that follows it is
+        /// read, or by finish.
+        void push_bytes(slice bytes) {
+            auto position = bytes.data;
+            const auto end = bytes.data + bytes.size;
+            slice token;
+            auto is_raw = false;
+            while (_tokenizer.next(position, end, false, token, is_raw)) {
+                push(token);
+            }
+        }
+
+        /// finish ends the command line: it pushes the last token read from bytes, reports an unterminated quote,
+        /// a missing parameter and missing arguments, and resets the parser for the next command line.
+        void finish() {
+            slice token;
+            auto is_raw = false;
+            const char* position = nullptr;
+            if (_tokenizer.quote() != 0) {
+                const auto pending = std::string(1, _tokenizer.quote()) + _tokenizer.pending().to_string();
+                _handle_error(error{
+                    error_kind::unterminated_quote,
+                    _state.index + 1,
+                    slice(pending),
+                    slice(),
+                    nullptr,
+                    _parser->number_of_arguments()});
+            } else if (_tokenizer.next(position, position, true, token, is_raw)) {
+                push(token);
+            }
+            if (_state.is_awaiting_parameter) {
+                _state.option_token = slice(_option_token);
+            }
+            finish_tokens(_state, _parser->number_of_arguments(), _handle_error);
+            _state = token_state();
+            _tokenizer.reset();
+        }
+
+        /// is_awaiting_parameter returns true if the last token is an option whose parameter is the next token.
+        bool is_awaiting_parameter() const {
+            return _state.is_awaiting_parameter;
+        }
+
+        /// index returns the number of tokens pushed since the beginning of the command line.
+        std::size_t index() const {
+            return _state.index;
+        }
+
+        protected:
+        const Parser* _parser;
+        HandleArgument _handle_argument;
+        HandleOption _handle_option;
+        HandleFlag _handle_flag;
+        HandleError _handle_error;
+        token_state _state;
+        std::string _option_token;
+        shell_tokenizer _tokenizer;
+    };
+
+    /// make_incremental_parser creates an incremental_parser. Without handle_error, errors are thrown.
+    template <
+        typename Parser,
+        typename HandleArgument,
+        typename HandleOption,
+        typename HandleFlag,
+        typename HandleError>
+    inline incremental_parser<Parser, HandleArgument, HandleOption, HandleFlag, HandleError> make_incremental_parser(
+        const Parser& parser,
+        HandleArgument handle_argument,
+        HandleOption handle_option,
+        HandleFlag handle_flag,
+        HandleError handle_error) {
+        return incremental_parser<Parser, HandleArgument, HandleOption, HandleFlag, HandleError>(
+            parser, handle_argument, handle_option, handle_flag, handle_error);
+    }
+    template <typename Parser, typename HandleArgument, typename HandleOption, typename HandleFlag>
+    inline incremental_parser<Parser, HandleArgument, HandleOption, HandleFlag, void (*)(const error&)>
+    make_incremental_parser(
+        const Parser& parser,
+        HandleArgument handle_argument,
+        HandleOption handle_option,
+        HandleFlag handle_flag) {
+        return incremental_parser<Parser, HandleArgument, HandleOption, HandleFlag, void (*)(const error&)>(
+            parser, handle_argument, handle_option, handle_flag, throw_error);
+    }
+
+    /// parser_methods implements parse, parse_view and visit for a parser type (Derived).
+    /// Derived must implement find, names, size, number_of_arguments, arguments_type, path_threads and path_check.
+    /// parse, parse_view, try_parse and try_parse_view check the paths once the command line is parsed (see
+    /// path_checker), if path_check is not null. parse and parse_view report every invalid path in a single exception.
+    /// Each method accepts either argc and argv, or a tokens object (for example response_file_tokens).
+    template <typename Derived>
+    class parser_methods {
+        public:
+        /// parse turns argc and argv (or tokens) into parsed arguments and options.
+        /// The returned command's containers use the given allocator.
+        template <typename Tokens, typename Allocator>
+        basic_command<Allocator> parse(Tokens& tokens, const Allocator& allocator) const {
+            auto checker = make_path_checker();
+            auto command = parse_command(
+                tokens,
+                derived().number_of_arguments(),
+                [this](slice name_or_alias, match& match) { return derived().find(name_or_alias, match); },
+                derived().names(),
+                derived().size(),
+                allocator,
+                throw_error,
+                derived().path_check() == nullptr ? nullptr : &checker);
+            check_paths(checker);
+            return command;
+        }
+        template <typename Tokens>
+        command parse(Tokens& tokens) const {
+            return derived().parse(tokens, std::allocator<char>());
+        }
+        template <typename Allocator>
+        basic_command<Allocator> parse(int argc, char* argv[], const Allocator& allocator) const {
+            argv_tokens tokens(argc, argv);
+            return derived().parse(tokens, allocator);
+        }
+        command parse(int argc, char* argv[]) const {
+            return parse(argc, argv, std::allocator<char>());
+        }
+
+        /// parse_view turns argc and argv (or tokens) into parsed arguments and options without copying them.
+        /// The returned command_view allocates its containers once, and never per element.
+        template <typename Tokens, typename Allocator>
+        basic_command_view<Allocator> parse_view(Tokens& tokens, const Allocator& allocator) const {
+            auto checker = make_path_checker();
+            auto command_view = parse_command_view(
+                tokens,
+                derived().number_of_arguments(),
+                [this](slice name_or_alias, match& match) { return derived().find(name_or_alias, match); },
+                derived().names(),
+                derived().size(),
+                allocator,
+                throw_error,
+                derived().path_check() == nullptr ? nullptr : &checker);
+            check_paths(checker);
+            return command_view;
+        }
+        template <typename Tokens>
+        command_view parse_view(Tokens& tokens) const {
+            return derived().parse_view(tokens, std::allocator<char>());
+        }
+        template <typename Allocator>
+        basic_command_view<Allocator> parse_view(int argc, char* argv[], const Allocator& allocator) const {
+            argv_tokens tokens(argc, argv);
+            return derived().parse_view(tokens, allocator);
+        }
+        command_view parse_view(int argc, char* argv[]) const {
+            return parse_view(argc, argv, std::allocator<char>());
+        }
+
+        /// try_parse is a variant of parse that does not throw when the command line is invalid.
+        /// It reads every token, and returns the command with the list of errors (including the errors reported by
+        /// the tokens object, for example a missing response file).
+        template <typename Tokens, typename Allocator>
+        outcome<basic_command<Allocator>> try_parse(Tokens& tokens, const Allocator& allocator) const {
+            std::vector<error> errors;
+            auto checker = make_path_checker();
+            auto command = parse_command(
+                tokens,
+                derived().number_of_arguments(),
+                [this](slice name_or_alias, match& match) { return derived().find(name_or_alias, match); },
+                derived().names(),
+                derived().size(),
+                allocator,
+                [&](const error& error) { errors.push_back(error); },
+                derived().path_check() == nullptr ? nullptr : &checker);
+            check_paths(checker, errors);
+            return outcome<basic_command<Allocator>>{std::move(command), std::move(errors)};
+        }
+        template <typename Tokens>
+        outcome<command> try_parse(Tokens& tokens) const {
+            return derived().try_parse(tokens, std::allocator<char>());
+        }
+        template <typename Allocator>
+        outcome<basic_command<Allocator>> try_parse(int argc, char* argv[], const Allocator& allocator) const {
+            argv_tokens tokens(argc, argv);
+            return derived().try_parse(tokens, allocator);
+        }
+        outcome<command> try_parse(int argc, char* argv[]) const {
+            return try_parse(argc, argv, std::allocator<char>());
+        }
+
+        /// try_parse_view is a variant of parse_view that does not throw when the command line is invalid.
+        /// It reads every token, and returns the command_view with the list of errors.
+        template <typename Tokens, typename Allocator>
+        outcome<basic_command_view<Allocator>> try_parse_view(Tokens& tokens, const Allocator& allocator) const {
+            std::vector<error> errors;
+            auto checker = make_path_checker();
+            auto command_view = parse_command_view(
+                tokens,
+                derived().number_of_arguments(),
+                [this](slice name_or_alias, match& match) { return derived().find(name_or_alias, match); },
+                derived().names(),
+                derived().size(),
+                allocator,
+                [&](const error& error) { errors.push_back(error); },
+                derived().path_check() == nullptr ? nullptr : &checker);
+            check_paths(checker, errors);
+            return outcome<basic_command_view<Allocator>>{std::move(command_view), std::move(errors)};
+        }
+        template <typename Tokens>
+        outcome<command_view> try_parse_view(Tokens& tokens) const {
+            return derived().try_parse_view(tokens, std::allocator<char>());
+        }
+        template <typename Allocator>
+        outcome<basic_command_view<Allocator>>
+        try_parse_view(int argc, char* argv[], const Allocator& allocator) const {
+            argv_tokens tokens(argc, argv);
+            return derived().try_parse_view(tokens, allocator);
+        }
+        outcome<command_view> try_parse_view(int argc, char* argv[]) const {
+            return try_parse_view(argc, argv, std::allocator<char>());
+        }
+
+        /// visit turns argc and argv (or tokens) into parsed arguments and options, and calls the handlers as soon as
+        /// each element is recognised, without storing them.
+        /// The handlers must be compatible with the expressions `handle_argument(slice argument)`,
+        /// `handle_option(const match& match, slice parameter)` and `handle_flag(const match& match)`.
+        /// Errors are thrown when detected, possibly after some elements were handled (for example, when the number of
+        /// arguments is too small).
+        /// Typed parameters are passed as is, and can be converted with convert or convert_list and match.type.
+        template <typename Tokens, typename HandleArgument, typename HandleOption, typename HandleFlag>
+        void visit(
+            Tokens& tokens,
+            HandleArgument handle_argument,
+            HandleOption handle_option,
+            HandleFlag handle_flag) const {
+            parse_tokens(
+                tokens,
+                derived().number_of_arguments(),
+                [this](slice name_or_alias, match& match) { return derived().find(name_or_alias, match); },
+                handle_argument,
+                [&](const match& match, slice parameter) {
+                    handle_option(match, parameter);
+                    return true;
+                },
+                handle_flag,
+                throw_error);
+        }
+        template <typename HandleArgument, typename HandleOption, typename HandleFlag>
+        void visit(
+            int argc,
+            char* argv[],
+            HandleArgument handle_argument,
+            HandleOption handle_option,
+            HandleFlag handle_flag) const {
+            argv_tokens tokens(argc, argv);
+            derived().visit(tokens, handle_argument, handle_option, handle_flag);
+        }
+
+        protected:
+        /// derived casts this object to the parser type.
+        const Derived& derived() const {
+            return *static_cast<const Derived*>(this);
+        }
+
+        /// make_path_checker creates a path checker with the parser's settings.
+        path_checker make_path_checker() const {
+            return path_checker(derived().arguments_type(), derived().path_threads(), derived().path_check());
+        }
+
+        /// check_paths checks the registered paths, and throws a single exception if some are invalid.
+        void check_paths(path_checker& checker) const {
+            std::vector<error> errors;
+            checker.check(derived().number_of_arguments(), [&](const error& error) { errors.push_back(error); });
+            if (!errors.empty()) {
+                throw_errors(errors);
+            }
+        }
+
+        /// check_paths checks the registered paths, and merges the invalid ones with the other errors, by index.
+        void check_paths(path_checker& checker, std::vector<error>& errors) const {
+            const auto number_of_errors = errors.size();
+            checker.check(derived().number_of_arguments(), [&](const error& error) { errors.push_back(error); });
+            std::inplace_merge(
+                errors.begin(),
+                errors.begin() + static_cast<std::ptrdiff_t>(number_of_errors),
+                errors.end(),
+                [](const error& first, const error& second) { return first.index < second.index; });
+        }
+    };
+
+    /// observed_parser wraps a parser (or a static parser), and reports tokenization and lookups to an observer.
+    /// It provides the same parse, parse_view, try_parse, try_parse_view and visit methods, and does not own the
+    /// parser nor the observer. Allocations are reported if the command is allocated with an observed_allocator.
+    template <typename Parser, typename Observer>
+    class observed_parser : public parser_methods<observed_parser<Parser, Observer>> {
+        public:
+        typedef parser_methods<observed_parser<Parser, Observer>> base;
+        using base::parse;
+        using base::parse_view;
+        using base::try_parse;
+        using base::try_parse_view;
+        using base::visit;
+
+        observed_parser(const Parser& parser, Observer& observer) : _parser(&parser), _observer(&observer) {}
+        observed_parser(const observed_parser&) = default;
+        observed_parser(observed_parser&&) = default;
+        observed_parser& operator=(const observed_parser&) = default;
+        observed_parser& operator=(observed_parser&&) = default;
+        ~observed_parser() {}
+
+        template <typename Tokens, typename Allocator>
+        basic_command<Allocator> parse(Tokens& tokens, const Allocator& allocator) const {
+            observed_tokens<Tokens, Observer> observed(tokens, *_observer);
+            return base::parse(observed, allocator);
+        }
+        template <typename Tokens, typename Allocator>
+        basic_command_view<Allocator> parse_view(Tokens& tokens, const Allocator& allocator) const {
+            observed_tokens<Tokens, Observer> observed(tokens, *_observer);
+            return base::parse_view(observed, allocator);
+        }
+        template <typename Tokens, typename Allocator>
+        outcome<basic_command<Allocator>> try_parse(Tokens& tokens, const Allocator& allocator) const {
+            observed_tokens<Tokens, Observer> observed(tokens, *_observer);
+            return base::try_parse(observed, allocator);
+        }
+        template <typename Tokens, typename Allocator>
+        outcome<basic_command_view<Allocator>> try_parse_view(Tokens& tokens, const Allocator& allocator) const {
+            observed_tokens<Tokens, Observer> observed(tokens, *_observer);
+            return base::try_parse_view(observed, allocator);
+        }
+        template <typename Tokens, typename HandleArgument, typename HandleOption, typename HandleFlag>
+        void visit(
+            Tokens& tokens,
+            HandleArgument handle_argument,
+            HandleOption handle_option,
+            HandleFlag handle_flag) const {
+            observed_tokens<Tokens, Observer> observed(tokens, *_observer);
+            base::visit(observed, handle_argument, handle_option, handle_flag);
+        }
+
+        /// find times the parser's find, and reports the result.
+        bool find(slice name_or_alias, match& match) const {
+            _observer->begin(phase::lookup);
+            const auto is_found = _parser->find(name_or_alias, match);
+            _observer->end(phase::lookup);
+            _observer->lookup(name_or_alias, match, is_found);
+            return is_found;
+        }
+
+        const slice* names() const {
+            return _parser->names();
+        }
+
+        std::size_t size() const {
+            return _parser->size();
+        }
+
+        int64_t number_of_arguments() const {
+            return _parser->number_of_arguments();
+        }
+
+        const parameter_type* arguments_type() const {
+            return _parser->arguments_type();
+        }
+
+        std::size_t path_threads() const {
+            return _parser->path_threads();
+        }
+
+        pontella::path_check path_check() const {
+            return _parser->path_check();
+        }
+
+        protected:
+        const Parser* _parser;
+        Observer* _observer;
+    };
+
+    /// observe creates an observed_parser.
+    template <typename Parser, typename Observer>
+    inline observed_parser<Parser, Observer> observe(const Parser& parser, Observer& observer) {
+        return observed_parser<Parser, Observer>(parser, observer);
+    }
+
+    /// completion_kind describes the word under the cursor of a partial command line.
+    enum class completion_kind {
+        /// name is an option or flag name or alias, the candidates start with dashes.
+        name,
+
+        /// choice is the parameter of an enumeration option.
+        choice,
+
+        /// parameter is a free parameter of an option, left to the shell (for example file names).
+        parameter,
+
+        /// argument is a positional argument, left to the shell.
+        argument,
+
+        /// none means that nothing is accepted at this position.
+        none,
+    };
+
+    /// completion contains the candidates for the word under the cursor, sorted lexicographically.
+    struct completion {
+        completion_kind kind;
+        std::vector<std::string> candidates;
+
+        /// argument_index is the index of the positional argument, if kind is completion_kind::argument.
+        std::size_t argument_index;
+    };
+
+    /// shell lists the shells supported by completion scripts.
+    enum class shell { bash, zsh, fish };
+
+    /// shell_quote wraps a word in single quotes, so that shells read it verbatim.
+    inline std::string shell_quote(const std::string& word) {
+        std::string result("'");
+        for (const auto character : word) {
+            if (character == '\'') {
+                result.append("'\\''");
+            } else {
+                result.push_back(character);
+            }
+        }
+        result.push_back('\'');
+        return result;
+    }
+
+    /// parser validates options and flags once, and turns many argc and argv into parsed arguments and options.
+    /// parse is const, therefore a single parser can be shared by several threads.
+    /// Each label gets an id: options are numbered first, then flags, in declaration order.
+    class parser : public parser_methods<parser> {
+        public:
+        /// If number_of_arguments is negative, the number of arguments is unlimited.
+        /// The observer, if any, is told the time spent on validation and on the construction of the tables.
+        /// The iterators must refer to labels that remain valid until the constructor returns (forward iterators).
+        template <typename OptionIterator, typename FlagIterator, typename Observer>
+        parser(
+            int64_t number_of_arguments,
+            OptionIterator options_begin,
+            OptionIterator options_end,
+            FlagIterator flags_begin,
+            FlagIterator flags_end,
+            Observer&& observer) :
+            _number_of_arguments(number_of_arguments),
+            _is_prefix_matching(false),
+            _maximum_length(0),
+            _path_threads(16),
+            _path_check(nullptr) {
+            auto names = std::make_shared<std::vector<std::string>>();
+            std::vector<entry> entries;
+            observer.begin(phase::validation);
+            add_labels(options_begin, options_end, true, entries, *names, _is_repeatable, _types);
+            _number_of_options = names->size();
+            add_labels(flags_begin, flags_end, false, entries, *names, _is_repeatable, _types);
+            for (const auto& type : _types) {
+                if (type.check_paths != nullptr) {
+                    _path_check = type.check_paths;
+                }
+            }
+            std::sort(entries.begin(), entries.end(), [](const entry& first, const entry& second) {
+                return first.key != second.key ? first.key < second.key :
+                                                 compare(first.name_or_alias, second.name_or_alias) < 0;
+            });
+            auto number_of_nodes = static_cast<std::size_t>(1);
+            std::size_t number_of_characters = 0;
+            for (std::size_t index = 0; index < entries.size(); ++index) {
+                const auto& name_or_alias = entries[index].name_or_alias;
+                _maximum_length = std::max(_maximum_length, name_or_alias.size);
+                number_of_characters += name_or_alias.size;
+                if (index == 0) {
+                    number_of_nodes += name_or_alias.size;
+                    continue;
+                }
+                const auto& previous = entries[index - 1];
+                if (compare(previous.name_or_alias, name_or_alias) == 0) {
+                    throw_duplicate(previous, entries[index]);
+                }
+                std::size_t common = 0;
+                while (common < previous.name_or_alias.size && common < name_or_alias.size
+                       && previous.name_or_alias.data[common] == name_or_alias.data[common]) {
+                    ++common;
+                }
+                number_of_nodes += name_or_alias.size - common;
+            }
+            observer.end(phase::validation);
+            observer.begin(phase::construction);
+            auto candidates = std::make_shared<std::string>();
+            candidates->reserve(number_of_characters + 4 * entries.size());
+            for (auto& entry : entries) {
+                candidates->append(candidates->empty() ? "" : "', '");
+                entry.candidate = candidates->size();
+                candidates->append(entry.name_or_alias.data, entry.name_or_alias.size);
+            }
+            _candidates = candidates;
+            _nodes.reserve(number_of_nodes);
+            _edges.reserve(number_of_nodes - 1);
+            build_trie(entries, 0, entries.size(), 0);
+            _names.reserve(names->size());
+            for (const auto& name : *names) {
+                _names.emplace_back(name);
+            }
+            _names_storage = names;
+            observer.end(phase::construction);
+        }
+        template <typename OptionIterator, typename FlagIterator>
+        parser(
+            int64_t number_of_arguments,
+            OptionIterator options_begin,
+            OptionIterator options_end,
+            FlagIterator flags_begin,
+            FlagIterator flags_end) :
+            parser(number_of_arguments, options_begin, options_end, flags_begin, flags_end, null_observer()) {}
+        template <typename OptionIterator>
+        parser(
+            int64_t number_of_arguments,
+            OptionIterator options_begin,
+            OptionIterator options_end,
+            std::initializer_list<label> flags) :
+            parser(number_of_arguments, options_begin, options_end, flags.begin(), flags.end()) {}
+        template <typename FlagIterator>
+        parser(
+            int64_t number_of_arguments,
+            std::initializer_list<label> options,
+            FlagIterator flags_begin,
+            FlagIterator flags_end) :
+            parser(number_of_arguments, options.begin(), options.end(), flags_begin, flags_end) {}
+        parser(int64_t number_of_arguments, std::initializer_list<label> options, std::initializer_list<label> flags) :
+            parser(number_of_arguments, options.begin(), options.end(), flags.begin(), flags.end()) {}
+        parser(const parser&) = default;
+        parser(parser&&) = default;
+        parser& operator=(const parser&) = default;
+        parser& operator=(parser&&) = default;
+        ~parser() {}
+
+        /// allow_prefixes enables (or disables) unambiguous prefix matching: a prefix of the names and aliases of a
+        /// single label (for example "verb" for "verbose") is then accepted. Exact names and aliases take precedence.
+        parser& allow_prefixes(bool is_prefix_matching = true) {
+            _is_prefix_matching = is_prefix_matching;
+            return *this;
+        }
+
+        /// check_arguments gives the positional arguments a path type (see path). The arguments are then checked
+        /// against the filesystem along with the path options, once the command line is parsed.
+        /// It throws if the type is not a path type.
+        parser& check_arguments(parameter_type type) {
+            if (type.kind != parameter_kind::path) {
+                throw_exception(std::logic_error("The positional arguments type must be a path type"));
+            }
+            if (type.check_paths != nullptr) {
+                _path_check = type.check_paths;
+            }
+            _arguments_type = std::move(type);
+            return *this;
+        }
+
+        /// limit_path_threads sets the maximum number of threads used to check the paths of a command line (16 by
+        /// default, a single path is checked on the calling thread).
+        parser& limit_path_threads(std::size_t number_of_threads) {
+            _path_threads = std::max(static_cast<std::size_t>(1), number_of_threads);
+            return *this;
+        }
+
+        /// find retrieves the option or flag associated with a name or alias.
+        /// It walks a trie of the names and aliases in O(size of name_or_alias), and does not allocate memory (unless
+        /// the suggestion allocates, see suggest).
+        /// If there is no such option or flag, match.name is set to the name of the closest label (see suggest).
+        /// If prefixes are allowed and name_or_alias is the prefix of several labels, match.is_ambiguous is set and
+        /// match.name lists the matching names and aliases instead.
+        bool find(slice name_or_alias, match& match) const {
+            slice candidates;
+            const auto id = lookup(name_or_alias, candidates);
+            if (id == npos) {
+                match.is_ambiguous = candidates.data != nullptr;
+                match.name = match.is_ambiguous ? candidates : suggest(name_or_alias);
+                return false;
+            }
+            match.is_ambiguous = false;
+            match.is_option = id < _number_of_options;
+            match.id = id;
+            match.is_repeatable = _is_repeatable[id];
+            match.name = _names[id];
+            match.type = _types[id].kind == parameter_kind::string ? nullptr : &_types[id];
+            return true;
+        }
+
+        /// suggest returns the name of the label whose name or alias is the closest to the given string (Levenshtein
+        /// distance), or a null slice if none is close enough. The accepted distance is a third of the size of the
+        /// given string, and at most 2. The trie is explored depth-first, and branches whose distance exceeds the
+        /// bound are pruned, so that most names are never visited.
+        /// Pruning bounds the depth of the exploration to the size of the string plus the accepted distance, hence the
+        /// rows of the distance matrix fit on the stack for strings up to 29 characters, and suggest only allocates
+        /// memory for longer strings.
+        slice suggest(slice name_or_alias) const {
+            const auto maximum_distance = std::min(static_cast<std::size_t>(2), name_or_alias.size / 3);
+            if (maximum_distance == 0 || _nodes.empty()) {
+                return slice();
+            }
+            const auto row_size = name_or_alias.size + 1;
+            const auto size =
+                row_size * (std::min(_maximum_length, name_or_alias.size + maximum_distance + 1) + 1);
+            std::size_t buffer[1024];
+            std::vector<std::size_t> storage;
+            auto rows = buffer;
+            if (size > sizeof(buffer) / sizeof(std::size_t)) {
+                storage.resize(size);
+                rows = storage.data();
+            }
+            for (std::size_t index = 0; index < row_size; ++index) {
+                rows[index] = index;
+            }
+            auto best_distance = maximum_distance + 1;
+            auto best_id = npos;
+            suggest_from(0, 0, name_or_alias, rows, best_distance, best_id);
+            return best_id == npos ? slice() : _names[best_id];
+        }
+
+        /// id returns the id of the label with the given name or alias.
+        /// It throws if the name or alias is not associated with a label.
+        std::size_t id(slice name_or_alias) const {
+            match match;
+            if (!find(name_or_alias, match)) {
+                throw_exception(
+                    std::logic_error("Unknown option or flag name or alias '" + name_or_alias.to_string() + "'"));
+            }
+            return match.id;
+        }
+
+        /// name returns the name of the label with the given id.
+        slice name(std::size_t id) const {
+            return _names[id];
+        }
+
+        /// names returns a pointer to the name of each label.
+        const slice* names() const {
+            return _names.data();
+        }
+
+        /// size returns the number of labels.
+        std::size_t size() const {
+            return _names.size();
+        }
+
+        /// number_of_arguments returns the expected number of positional arguments (negative if unlimited).
+        int64_t number_of_arguments() const {
+            return _number_of_arguments;
+        }
+
+        /// arguments_type returns the path type of the positional arguments, or nullptr if they are not checked.
+        const parameter_type* arguments_type() const {
+            return _arguments_type.kind == parameter_kind::path ? &_arguments_type : nullptr;
+        }
+
+        /// path_threads returns the maximum number of threads used to check paths.
+        std::size_t path_threads() const {
+            return _path_threads;
+        }
+
+        /// path_check returns the function that checks paths, or nullptr if neither the labels nor the positional
+        /// arguments have a path type.
+        pontella::path_check path_check() const {
+            return _path_check;
+        }
+
+        /// complete returns the completions of the word with the given index in a partial command line.
+        /// argv[0] is the program name, and index can be argc when the cursor follows a space (the word is then empty).
+        /// Names and aliases are matched by prefix against the trie, hence the cost does not depend on the number of
+        /// labels that do not match.
+        /// With an empty word or a lone dash, names are completed with two dashes and aliases with one. Otherwise, the
+        /// candidates keep the dashes typed by the user. Words that follow "--name=" are completed as parameters.
+        completion complete(int argc, char* argv[], int index) const {
+            completion result{completion_kind::none, {}, 0};
+            if (index < 1) {
+                return result;
+            }
+            std::size_t number_of_arguments = 0;
+            auto option_id = npos;
+            for (int token_index = 1; token_index < index && token_index < argc; ++token_index) {
+                const slice token(argv[token_index]);
+                if (option_id != npos) {
+                    option_id = npos;
+                } else if (token.size > 0 && token.data[0] == '-') {
+                    const auto name_or_alias = name_of(token);
+                    if (name_or_alias.data + name_or_alias.size == token.data + token.size) {
+                        const auto id = lookup(name_or_alias);
+                        if (id < _number_of_options) {
+                            option_id = id;
+                        }
+                    }
+                } else {
+                    ++number_of_arguments;
+                }
+            }
+            const auto word = index < argc ? slice(argv[index]) : slice("");
+            if (option_id != npos) {
+                complete_parameter(option_id, slice(), word, result);
+            } else if (word.size > 0 && word.data[0] == '-') {
+                const auto name_or_alias = name_of(word);
+                const auto dashes_size = static_cast<std::size_t>(name_or_alias.data - word.data);
+                if (name_or_alias.data + name_or_alias.size < word.data + word.size) {
+                    const auto id = lookup(name_or_alias);
+                    if (id < _number_of_options) {
+                        const auto prefix_size = dashes_size + name_or_alias.size + 1;
+                        complete_parameter(
+                            id,
+                            slice(word.data, prefix_size),
+                            slice(word.data + prefix_size, word.size - prefix_size),
+                            result);
+                    }
+                } else {
+                    complete_names(slice(word.data, word.size == 1 ? 0 : dashes_size), name_or_alias, result);
+                }
+            } else if (
+                _number_of_arguments < 0 || number_of_arguments < static_cast<std::size_t>(_number_of_arguments)) {
+                result.kind = completion_kind::argument;
+                result.argument_index = number_of_arguments;
+            } else if (word.size == 0) {
+                complete_names(slice(), slice(), result);
+            }
+            return result;
+        }
+
+        /// completion_script generates a completion script for the given shell and program name.
+        /// The names, aliases and choices are embedded in the script, so that completing them does not start the
+        /// program. The shell completes free parameters and positional arguments with file names.
+        std::string completion_script(shell target, const std::string& program) const {
+            std::vector<std::vector<std::string>> aliases(_names.size());
+            std::string buffer;
+            auto handle_entry = [&](const std::string& name_or_alias, std::size_t id) {
+                if (compare(name_or_alias, _names[id]) != 0) {
+                    aliases[id].push_back(name_or_alias);
+                }
+            };
+            for_each_entry(0, buffer, handle_entry);
+            std::string function("_pontella_");
+            for (const auto character : program) {
+                function.push_back(std::isalnum(static_cast<unsigned char>(character)) ? character : '_');
+            }
+            std::string words;
+            std::string quoted_words;
+            for (std::size_t id = 0; id < _names.size(); ++id) {
+                const auto name = "--" + _names[id].to_string();
+                words.append(words.empty() ? "" : " ").append(name);
+                quoted_words.append(quoted_words.empty() ? "" : " ").append(shell_quote(name));
+                for (const auto& alias : aliases[id]) {
+                    words.append(" -").append(alias);
+                    quoted_words.append(" ").append(shell_quote("-" + alias));
+                }
+            }
+            const auto quoted_program = shell_quote(program);
+            std::string result;
+            if (target == shell::fish) {
+                for (std::size_t id = 0; id < _names.size(); ++id) {
+                    result.append("complete -c ").append(quoted_program);
+                    result.append(" -l ").append(shell_quote(_names[id].to_string()));
+                    for (const auto& alias : aliases[id]) {
+                        result.append(alias.size() == 1 ? " -s " : " -o ").append(shell_quote(alias));
+                    }
+                    if (id < _number_of_options) {
+                        if (_types[id].kind == parameter_kind::enumeration) {
+                            result.append(" -x -a ").append(shell_quote(join_choices(id, false)));
+                        } else {
+                            result.append(" -r");
+                        }
+                    }
+                    result.append("\n");
+                }
+                return result;
+            }
+            const auto is_bash = target == shell::bash;
+            if (!is_bash) {
+                result.append("#compdef ").append(program).append("\n");
+            }
+            result.append(function).append("() {\n");
+            if (is_bash) {
+                result.append("    local current=\"${COMP_WORDS[COMP_CWORD]}\"\n");
+                result.append("    local previous=\"${COMP_WORDS[COMP_CWORD-1]}\"\n");
+            } else {
+                result.append("    local current=\"${words[CURRENT]}\"\n");
+                result.append("    local previous=\"${words[CURRENT-1]}\"\n");
+            }
+            result.append("    case \"$previous\" in\n");
+            for (std::size_t id = 0; id < _number_of_options; ++id) {
+                const auto name = _names[id].to_string();
+                result.append("        ").append(shell_quote("--" + name)).append("|").append(shell_quote("-" + name));
+                for (const auto& alias : aliases[id]) {
+                    result.append("|").append(shell_quote("--" + alias)).append("|").append(shell_quote("-" + alias));
+                }
+                result.append(")");
+                if (_types[id].kind == parameter_kind::enumeration) {
+                    if (is_bash) {
+                        result.append(" COMPREPLY=($(compgen -W ").append(shell_quote(join_choices(id, false)));
+                        result.append(" -- \"$current\"));");
+                    } else {
+                        result.append(" compadd -- ").append(join_choices(id, true)).append(";");
+                    }
+                } else if (!is_bash) {
+                    result.append(" _files;");
+                }
+                result.append(" return;;\n");
+            }
+            result.append("    esac\n");
+            result.append("    if [[ \"$current\" == -* ]]; then\n");
+            if (is_bash) {
+                result.append("        COMPREPLY=($(compgen -W ").append(shell_quote(words));
+                result.append(" -- \"$current\"))\n");
+                result.append("    fi\n");
+                result.append("}\n");
+                result.append("complete -o default -F ").append(function).append(" ").append(quoted_program);
+            } else {
+                result.append("        compadd -- ").append(quoted_words).append("\n");
+                result.append("    else\n");
+                result.append("        _files\n");
+                result.append("    fi\n");
+                result.append("}\n");
+                result.append("compdef ").append(function).append(" ").append(quoted_program);
+            }
+            result.append("\n");
+            return result;
+        }
+
+        protected:
+        /// entry associates a name or alias, which points to the labels given to the constructor, with a label id.
+        /// is_alias distinguishes aliases from names in the errors of duplicated entries.
+        struct entry {
+            slice name_or_alias;
+
+            /// key contains the first 8 characters (padded with zeros), most significant first, so that most
+            /// comparisons of the sort are integer comparisons.
+            uint64_t key;
+
+            std::size_t id;
+            bool is_alias;
+
+            /// candidate is the index of the name or alias in the parser's candidates.
+            std::size_t candidate;
+
+            entry(slice name_or_alias, std::size_t id, bool is_alias) :
+                name_or_alias(name_or_alias),
+                key(0),
+                id(id),
+                is_alias(is_alias),
+                candidate(0) {
+                for (std::size_t index = 0; index < 8; ++index) {
+                    key = (key << 8)
+                          | (index < name_or_alias.size ? static_cast<uint8_t>(name_or_alias.data[index]) : 0);
+                }
+            }
+        };
+
+        /// npos is the id of trie nodes that do not correspond to a label.
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        /// trie_node is a node of the names and aliases trie, stored in _nodes (the root has the index 0).
+        /// The node's edges are stored contiguously in _edges, sorted by character.
+        struct trie_node {
+            std::size_t edges_begin;
+            std::size_t edges_end;
+
+            /// id is the label id of the name or alias that ends at this node, or npos.
+            std::size_t id;
+
+            /// prefix_id is the label id shared by every name and alias that starts with this node's prefix, or npos.
+            std::size_t prefix_id;
+
+            /// candidates_begin and candidates_end delimit, in the parser's candidates, the names and aliases that
+            /// start with this node's prefix.
+            std::size_t candidates_begin;
+            std::size_t candidates_end;
+        };
+
+        /// trie_edge links a node to a child.
+        struct trie_edge {
+            unsigned char character;
+            std::size_t node;
+        };
+
+        /// build_trie creates the node of the given sorted entries, which share their first depth characters.
+        /// The node's edges are allocated in _edges before its children are created, so that they are contiguous.
+        std::size_t
+        build_trie(const std::vector<entry>& entries, std::size_t begin, std::size_t end, std::size_t depth) {
+            const auto node = _nodes.size();
+            _nodes.push_back(trie_node{0, 0, npos, npos, 0, 0});
+            if (begin == end) {
+                return node;
+            }
+            _nodes[node].candidates_begin = entries[begin].candidate;
+            _nodes[node].candidates_end = entries[end - 1].candidate + entries[end - 1].name_or_alias.size;
+            _nodes[node].prefix_id = entries[begin].id;
+            for (auto index = begin; index < end; ++index) {
+                if (entries[index].id != entries[begin].id) {
+                    _nodes[node].prefix_id = npos;
+                    break;
+                }
+            }
+            if (entries[begin].name_or_alias.size == depth) {
+                _nodes[node].id = entries[begin].id;
+                ++begin;
+            }
+            auto edge = _edges.size();
+            _nodes[node].edges_begin = edge;
+            for (auto index = begin; index < end; ++index) {
+                if (index == begin
+                    || entries[index].name_or_alias.data[depth] != entries[index - 1].name_or_alias.data[depth]) {
+                    _edges.push_back(trie_edge{static_cast<unsigned char>(entries[index].name_or_alias.data[depth]), 0});
+                }
+            }
+            _nodes[node].edges_end = _edges.size();
+            for (auto child_begin = begin; child_begin < end; ++edge) {
+                const auto character = entries[child_begin].name_or_alias.data[depth];
+                auto child_end = child_begin + 1;
+                while (child_end < end && entries[child_end].name_or_alias.data[depth] == character) {
+                    ++child_end;
+                }
+                const auto child = build_trie(entries, child_begin, child_end, depth + 1);
+                _edges[edge].node = child;
+                child_begin = child_end;
+            }
+            return node;
+        }
+
+        /// suggest_from computes the edit distances of the children of node, and updates the best label.
+        /// rows contains one row of the Levenshtein matrix per depth.
+        void suggest_from(
+            std::size_t node,
+            std::size_t depth,
+            slice name_or_alias,
+            std::size_t* rows,
+            std::size_t& best_distance,
+            std::size_t& best_id) const {
+            const auto row_size = name_or_alias.size + 1;
+            const auto row = rows + depth * row_size;
+            const auto next_row = row + row_size;
+            for (auto edge = _nodes[node].edges_begin; edge < _nodes[node].edges_end; ++edge) {
+                const auto character = static_cast<char>(_edges[edge].character);
+                next_row[0] = row[0] + 1;
+                auto minimum = next_row[0];
+                for (std::size_t index = 1; index < row_size; ++index) {
+                    next_row[index] = std::min(
+                        std::min(row[index] + 1, next_row[index - 1] + 1),
+                        row[index - 1] + (name_or_alias.data[index - 1] == character ? 0 : 1));
+                    minimum = std::min(minimum, next_row[index]);
+                }
+                const auto child = _edges[edge].node;
+                if (_nodes[child].id != npos && next_row[row_size - 1] < best_distance) {
+                    best_distance = next_row[row_size - 1];
+                    best_id = _nodes[child].id;
+                }
+                if (minimum < best_distance) {
+                    suggest_from(child, depth + 1, name_or_alias, rows, best_distance, best_id);
+                }
+            }
+        }
+
+        /// child returns the child of node along the given character, or npos.
+        std::size_t child(std::size_t node, char character) const {
+            const auto edges_begin = _edges.begin() + static_cast<std::ptrdiff_t>(_nodes[node].edges_begin);
+            const auto edges_end = _edges.begin() + static_cast<std::ptrdiff_t>(_nodes[node].edges_end);
+            const auto edge = std::lower_bound(
+                edges_begin,
+                edges_end,
+                static_cast<unsigned char>(character),
+                [](const trie_edge& edge, unsigned char character) { return edge.character < character; });
+            if (edge == edges_end || edge->character != static_cast<unsigned char>(character)) {
+                return npos;
+            }
+            return edge->node;
+        }
+
+        /// lookup returns the id of the label with the given name or alias (or unambiguous prefix, if prefixes are
+        /// allowed), or npos. An empty name or alias (for example "--=value") is not a prefix of every label.
+        /// If prefixes are allowed and name_or_alias is an ambiguous prefix, candidates is set to the matching names
+        /// and aliases.
+        std::size_t lookup(slice name_or_alias, slice& candidates) const {
+            if (name_or_alias.size == 0) {
+                return npos;
+            }
+            std::size_t node = 0;
+            for (std::size_t index = 0; index < name_or_alias.size; ++index) {
+                node = child(node, name_or_alias.data[index]);
+                if (node == npos) {
+                    return npos;
+                }
+            }
+            if (_nodes[node].id == npos && _is_prefix_matching) {
+                if (_nodes[node].prefix_id == npos) {
+                    candidates = slice(
+                        _candidates->data() + _nodes[node].candidates_begin,
+                        _nodes[node].candidates_end - _nodes[node].candidates_begin);
+                }
+                return _nodes[node].prefix_id;
+            }
+            return _nodes[node].id;
+        }
+        std::size_t lookup(slice name_or_alias) const {
+            slice candidates;
+            return lookup(name_or_alias, candidates);
+        }
 
-        /// flags contains the named flags given to the program.
-        std::unordered_set<std::string> flags;
-    };
+        /// for_each_entry calls handle_entry with each name or alias under node, in lexicographic order.
+        /// name_or_alias must contain the prefix of node, and is used as a buffer.
+        template <typename HandleEntry>
+        void for_each_entry(std::size_t node, std::string& name_or_alias, HandleEntry& handle_entry) const {
+            if (_nodes[node].id != npos) {
+                handle_entry(static_cast<const std::string&>(name_or_alias), _nodes[node].id);
+            }
+            for (auto edge = _nodes[node].edges_begin; edge < _nodes[node].edges_end; ++edge) {
+                name_or_alias.push_back(static_cast<char>(_edges[edge].character));
+                for_each_entry(_edges[edge].node, name_or_alias, handle_entry);
+                name_or_alias.pop_back();
+            }
+        }
 
-    /// label represents an option or flag name, and its aliases.
-    struct label {
-        std::string name;
-        std::unordered_set<std::string> aliases;
-    };
+        /// name_of returns the name or alias of a token that starts with a dash, without the dashes and the parameter.
+        static slice name_of(slice token) {
+            const auto dashes_size = static_cast<std::size_t>(token.size > 1 && token.data[1] == '-' ? 2 : 1);
+            const auto begin = token.data + dashes_size;
+            const auto end = std::find(begin, token.data + token.size, '=');
+            return slice(begin, static_cast<std::size_t>(end - begin));
+        }
 
-    /// validate throws if the given string does not match the criterions for being an option or flag.
-    inline void validate(const std::string& name_or_alias, bool is_option, bool is_name) {
-        if (name_or_alias.empty()) {
-            throw std::logic_error(
-                std::string(is_option ? "An option" : "A flag") + " " + (is_name ? "name " : "alias") + " is empty");
+        /// join_choices returns the choices of an enumeration option, separated by spaces.
+        std::string join_choices(std::size_t id, bool is_quoted) const {
+            std::string result;
+            for (const auto& choice : _types[id].choices) {
+                result.append(result.empty() ? "" : " ").append(is_quoted ? shell_quote(choice) : choice);
+            }
+            return result;
         }
-        const auto prefix = std::string("The ") + (is_option ? "option" : "flag") + " " + (is_name ? "name" : "alias")
-                            + " '" + name_or_alias + "' ";
-        if (name_or_alias[0] == '-') {
-            throw std::logic_error(prefix + "starts with the charcater '-'");
+
+        /// complete_names adds the names and aliases that start with prefix to the completion.
+        /// If dashes is empty, names get two dashes and aliases one.
+        void complete_names(slice dashes, slice prefix, completion& result) const {
+            result.kind = completion_kind::name;
+            std::size_t node = 0;
+            for (std::size_t index = 0; index < prefix.size && node != npos; ++index) {
+                node = child(node, prefix.data[index]);
+            }
+            if (node == npos) {
+                return;
+            }
+            std::string buffer(prefix.data, prefix.size);
+            auto handle_entry = [&](const std::string& name_or_alias, std::size_t id) {
+                if (dashes.size > 0) {
+                    result.candidates.push_back(dashes.to_string() + name_or_alias);
+                } else {
+                    result.candidates.push_back((compare(name_or_alias, _names[id]) == 0 ? "--" : "-") + name_or_alias);
+                }
+            };
+            for_each_entry(node, buffer, handle_entry);
+            std::sort(result.candidates.begin(), result.candidates.end());
         }
-        for (auto character : name_or_alias) {
-            if (isspace(character)) {
-                throw std::logic_error(prefix + "contains white-space characters");
+
+        /// complete_parameter adds the choices of an enumeration option that start with word to the completion,
+        /// preceded by prefix (for example "--name=").
+        void complete_parameter(std::size_t id, slice prefix, slice word, completion& result) const {
+            if (_types[id].kind != parameter_kind::enumeration) {
+                result.kind = completion_kind::parameter;
+                return;
             }
-            if (character == '=') {
-                throw std::logic_error(prefix + "contains the character '='");
+            result.kind = completion_kind::choice;
+            for (const auto& choice : _types[id].choices) {
+                if (choice.size() >= word.size && compare(slice(choice.data(), word.size), word) == 0) {
+                    result.candidates.push_back(prefix.to_string() + choice);
+                }
             }
+            std::sort(result.candidates.begin(), result.candidates.end());
         }
-    }
 
-    /// parse turns argc and argv into parsed arguments and options.
-    /// If number_of_arguments is negative, the number of arguments is unlimited.
-    template <typename OptionIterator, typename FlagIterator>
-    inline command parse(
-        int argc,
-        char* argv[],
-        int64_t number_of_arguments,
-        OptionIterator options_begin,
-        OptionIterator options_end,
-        FlagIterator flags_begin,
-        FlagIterator flags_end) {
-        std::unordered_map<std::string, bool> name_to_is_option;
-        std::unordered_map<std::string, std::string> alias_to_name;
-        for (; options_begin != options_end; ++options_begin) {
-            validate(options_begin->name, true, true);
-            if (!name_to_is_option.insert(std::make_pair(options_begin->name, true)).second) {
-                throw std::logic_error("Duplicated name '" + options_begin->name + "'");
+        /// throw_duplicate throws the error of two entries with the same name or alias.
+        [[noreturn]] static void throw_duplicate(const entry& first, const entry& second) {
+            const auto name_or_alias = first.name_or_alias.to_string();
+            if (first.is_alias && second.is_alias) {
+                throw_exception(std::logic_error("Duplicated alias '" + name_or_alias + "'"));
+            }
+            if (first.is_alias || second.is_alias) {
+                throw_exception(std::logic_error("Duplicated name and alias '" + name_or_alias + "'"));
             }
-            for (const auto& alias : options_begin->aliases) {
-                validate(alias, true, false);
-                if (name_to_is_option.find(alias) != name_to_is_option.end()) {
-                    throw std::logic_error("Duplicated name and alias '" + alias + "'");
+            throw_exception(std::logic_error("Duplicated name '" + name_or_alias + "'"));
+        }
+
+        /// add_labels validates the given labels, assigns consecutive ids to them, and appends their names and
+        /// aliases to entries. Duplicates are detected once the entries are sorted.
+        template <typename Iterator>
+        static void add_labels(
+            Iterator begin,
+            Iterator end,
+            bool is_option,
+            std::vector<entry>& entries,
+            std::vector<std::string>& names,
+            std::vector<bool>& is_repeatable,
+            std::vector<parameter_type>& types) {
+            for (; begin != end; ++begin) {
+                validate(begin->name, is_option, true);
+                if (!is_option && begin->is_repeatable) {
+                    throw_exception(std::logic_error("The flag '" + begin->name + "' cannot be repeatable"));
                 }
-                if (!alias_to_name.insert(std::make_pair(alias, options_begin->name)).second) {
-                    throw std::logic_error("Duplicated alias '" + alias + "'");
+                if (!is_option && begin->type.kind != parameter_kind::string) {
+                    throw_exception(std::logic_error("The flag '" + begin->name + "' cannot have a typed parameter"));
                 }
+                if (begin->type.kind == parameter_kind::enumeration && begin->type.choices.empty()) {
+                    throw_exception(std::logic_error("The option '" + begin->name + "' has no choices"));
+                }
+                if (begin->type.integer_minimum > begin->type.integer_maximum
+                    || begin->type.floating_minimum > begin->type.floating_maximum) {
+                    throw_exception(std::logic_error("The option '" + begin->name + "' has an empty range"));
+                }
+                entries.push_back(entry{slice(begin->name), names.size(), false});
+                for (const auto& alias : begin->aliases) {
+                    validate(alias, is_option, false);
+                    entries.push_back(entry{slice(alias), names.size(), true});
+                }
+                names.push_back(begin->name);
+                is_repeatable.push_back(begin->is_repeatable);
+                types.push_back(begin->type);
             }
         }
-        for (; flags_begin != flags_end; ++flags_begin) {
-            validate(flags_begin->name, false, true);
-            if (!name_to_is_option.insert(std::make_pair(flags_begin->name, false)).second) {
-                throw std::logic_error("Duplicated name '" + flags_begin->name + "'");
+
+        int64_t _number_of_arguments;
+        std::size_t _number_of_options;
+        std::vector<bool> _is_repeatable;
+        std::vector<parameter_type> _types;
+        bool _is_prefix_matching;
+        std::size_t _maximum_length;
+        parameter_type _arguments_type;
+        std::size_t _path_threads;
+        pontella::path_check _path_check;
+        std::vector<trie_node> _nodes;
+        std::vector<trie_edge> _edges;
+        std::shared_ptr<const std::vector<std::string>> _names_storage;
+        std::shared_ptr<const std::string> _candidates;
+        std::vector<slice> _names;
+    };
+
+    /// spool parses a file with one command line per line, in parallel and against a single parser.
+    /// The lines do not contain the program name, therefore errors' indices start at 1 for the first token of a line.
+    /// Each line is tokenized with tokenize_line, and lines are parsed in chunks of chunk_size lines distributed with
+    /// parallel_for. The outcomes are stored in the order of the lines. Errors' slices point to the mapped file or to
+    /// the spool, and their types to the parser, hence they are valid as long as both.
+    /// A carriage return before a newline is ignored, and the last line may omit its newline.
+    class spool {
+        public:
+        template <typename Parser>
+        spool(
+            const Parser& parser,
+            const std::string& filename,
+            std::size_t number_of_threads = 0,
+            std::size_t chunk_size = 1024) :
+            _file(new mapped_file(filename)) {
+            std::vector<slice> lines;
+            const auto end = _file->data() + _file->size();
+            for (auto position = _file->data(); position != end;) {
+                auto newline = static_cast<const char*>(
+                    std::memchr(position, '\n', static_cast<std::size_t>(end - position)));
+                const auto line_end = newline == nullptr ? end : newline;
+                lines.emplace_back(
+                    position,
+                    static_cast<std::size_t>(line_end - position)
+                        - (line_end != position && *(line_end - 1) == '\r' ? 1 : 0));
+                position = newline == nullptr ? end : newline + 1;
             }
-            for (const auto& alias : flags_begin->aliases) {
-                validate(alias, false, false);
-                if (name_to_is_option.find(alias) != name_to_is_option.end()) {
-                    throw std::logic_error("Duplicated name and alias '" + alias + "'");
-                }
-                if (!alias_to_name.insert(std::make_pair(alias, flags_begin->name)).second) {
-                    throw std::logic_error("Duplicated alias '" + alias + "'");
+            chunk_size = std::max(static_cast<std::size_t>(1), chunk_size);
+            const auto number_of_chunks = (lines.size() + chunk_size - 1) / chunk_size;
+            _outcomes.resize(lines.size());
+            _storages.resize(number_of_chunks);
+            parallel_for(number_of_chunks, number_of_threads, [&](std::size_t chunk) {
+                std::vector<slice> tokens;
+                const auto lines_end = std::min(lines.size(), (chunk + 1) * chunk_size);
+                for (auto index = chunk * chunk_size; index < lines_end; ++index) {
+                    tokens.clear();
+                    slice unterminated;
+                    if (!tokenize_line(lines[index], tokens, _storages[chunk], unterminated)) {
+                        _outcomes[index].errors.push_back(error{
+                            error_kind::unterminated_quote,
+                            tokens.size() + 1,
+                            unterminated,
+                            slice(),
+                            nullptr,
+                            parser.number_of_arguments()});
+                        continue;
+                    }
+                    slice_tokens line_tokens(tokens.data(), tokens.data() + tokens.size());
+                    _outcomes[index] = parser.try_parse(line_tokens);
                 }
+            });
+        }
+        spool(const spool&) = delete;
+        spool(spool&&) = default;
+        spool& operator=(const spool&) = delete;
+        spool& operator=(spool&&) = default;
+        ~spool() {}
+
+        /// size returns the number of lines.
+        std::size_t size() const {
+            return _outcomes.size();
+        }
+
+        /// operator[] returns the outcome of the line with the given index (starting at 0).
+        const outcome<command>& operator[](std::size_t index) const {
+            return _outcomes[index];
+        }
+
+        std::vector<outcome<command>>::const_iterator begin() const {
+            return _outcomes.begin();
+        }
+
+        std::vector<outcome<command>>::const_iterator end() const {
+            return _outcomes.end();
+        }
+
+        protected:
+        std::unique_ptr<mapped_file> _file;
+        std::vector<std::deque<std::string>> _storages;
+        std::vector<outcome<command>> _outcomes;
+    };
+
+    /// schema describes the positional arguments, options and flags of a command or subcommand.
+    /// If number_of_arguments is negative, the number of arguments is unlimited.
+    struct schema {
+        int64_t number_of_arguments;
+        std::vector<label> options;
+        std::vector<label> flags;
+    };
+
+    class command_tree;
+
+    /// routed_command contains the names of the selected subcommands, and the parsed command.
+    struct routed_command {
+        /// path contains the subcommand names, from the root (for example {"remote", "add"}).
+        std::vector<std::string> path;
+
+        /// command contains the arguments, options and flags, including the inherited options and flags.
+        pontella::command command;
+
+        /// subcommand points to the selected node of the command tree.
+        const command_tree* subcommand;
+    };
+
+    /// command_tree dispatches command lines to nested subcommands (for example "program remote add name url").
+    /// Each node creates its schema with a function called the first time the node is selected, hence only the
+    /// labels of the selected subcommand and of its ancestors are validated. Subcommands inherit the options and flags
+    /// of their ancestors (global options), which can be given before or after the subcommand names.
+    /// The root declares the flag help (alias h) unless its schema has a label named help, hence every subcommand
+    /// accepts it. A node whose schema declares the name or alias help replaces the flag, and a node whose schema
+    /// declares the name or alias h removes the alias, for itself and its subcommands.
+    /// Subcommand names are looked up in a sorted table built when subcommands are added, without allocations.
+    /// parse and try_parse are thread-safe, but subcommands must be added before the tree is shared.
+    class command_tree {
+        public:
+        typedef std::function<schema()> make_schema_type;
+        typedef std::function<void(const routed_command&)> handle_command_type;
+
+        /// handle_command is called by pontella::main when this node is selected, and can be empty.
+        command_tree(make_schema_type make_schema, handle_command_type handle_command = handle_command_type()) :
+            command_tree(nullptr, std::move(make_schema), std::move(handle_command)) {}
+        command_tree(const command_tree&) = delete;
+        command_tree(command_tree&&) = delete;
+        command_tree& operator=(const command_tree&) = delete;
+        command_tree& operator=(command_tree&&) = delete;
+        ~command_tree() {}
+
+        /// add creates a subcommand, and returns it so that subcommands can be added to it.
+        command_tree& add(
+            const std::string& name,
+            make_schema_type make_schema,
+            handle_command_type handle_command = handle_command_type()) {
+            if (name.empty() || name[0] == '-'
+                || std::any_of(name.begin(), name.end(), [](char character) {
+                       return std::isspace(static_cast<unsigned char>(character));
+                   })) {
+                throw_exception(std::logic_error("The subcommand name '" + name + "' is not valid"));
+            }
+            const auto position = std::lower_bound(
+                _subcommands.begin(),
+                _subcommands.end(),
+                name,
+                [](const subcommand_entry& entry, const std::string& name) { return entry.first < name; });
+            if (position != _subcommands.end() && position->first == name) {
+                throw_exception(std::logic_error("Duplicated subcommand '" + name + "'"));
             }
+            std::unique_ptr<command_tree> child(
+                new command_tree(this, std::move(make_schema), std::move(handle_command)));
+            auto& reference = *child;
+            _subcommands.insert(position, subcommand_entry(name, std::move(child)));
+            return reference;
         }
-        command command;
-        for (auto index = 1; index < argc; ++index) {
-            const std::string element(argv[index]);
-            if (element[0] == '-') {
-                std::string name_or_alias_and_parameter;
-                if (element.size() == 1) {
-                    throw std::runtime_error("Unexpected character '-' without an associated name or alias");
-                } else {
-                    if (element[1] == '-') {
-                        if (element.size() == 2) {
-                            throw std::runtime_error("Unexpected characters '--' without an associated name or alias");
-                        } else {
-                            name_or_alias_and_parameter = element.substr(2);
-                        }
-                    } else {
-                        name_or_alias_and_parameter = element.substr(1);
+
+        /// subcommand returns the subcommand with the given name, or nullptr.
+        const command_tree* subcommand(slice name) const {
+            const auto position = std::lower_bound(
+                _subcommands.begin(), _subcommands.end(), name, [](const subcommand_entry& entry, slice name) {
+                    return compare(slice(entry.first), name) < 0;
+                });
+            if (position == _subcommands.end() || compare(slice(position->first), name) != 0) {
+                return nullptr;
+            }
+            return position->second.get();
+        }
+
+        /// schema_parser returns the parser of this node, with the inherited options and flags.
+        /// The parser is created on first use, and the schema functions of this node and its ancestors are called at
+        /// most once.
+        const parser& schema_parser() const {
+            std::call_once(_once, [this]() {
+                if (_parent != nullptr) {
+                    _parent->schema_parser();
+                    _options = _parent->_options;
+                    _flags = _parent->_flags;
+                    _has_automatic_help = _parent->_has_automatic_help;
+                }
+                auto schema = _make_schema();
+                const auto declares = [&schema](const std::string& name_or_alias) {
+                    const auto is_declared = [&name_or_alias](const label& label) {
+                        return label.name == name_or_alias || label.aliases.count(name_or_alias) > 0;
+                    };
+                    return std::any_of(schema.options.begin(), schema.options.end(), is_declared)
+                           || std::any_of(schema.flags.begin(), schema.flags.end(), is_declared);
+                };
+                if (_parent == nullptr) {
+                    _has_automatic_help = !declares("help");
+                } else if (_has_automatic_help) {
+                    const auto help = std::find_if(
+                        _flags.begin(), _flags.end(), [](const label& label) { return label.name == "help"; });
+                    if (declares("help")) {
+                        _flags.erase(help);
+                        _has_automatic_help = false;
+                    } else if (declares("h")) {
+                        help->aliases.erase("h");
                     }
                 }
-                auto name_and_is_option = name_to_is_option.end();
-                std::string parameter;
-                auto has_equal = false;
-                {
-                    std::string name_or_alias;
-                    for (auto character_iterator = name_or_alias_and_parameter.begin();
-                         character_iterator != name_or_alias_and_parameter.end();
-                         ++character_iterator) {
-                        if (*character_iterator == '=') {
-                            has_equal = true;
-                            name_or_alias = std::string(name_or_alias_and_parameter.begin(), character_iterator);
-                            parameter = std::string(std::next(character_iterator), name_or_alias_and_parameter.end());
-                            break;
+                _options.insert(_options.end(), schema.options.begin(), schema.options.end());
+                _flags.insert(_flags.end(), schema.flags.begin(), schema.flags.end());
+                if (_parent == nullptr && _has_automatic_help) {
+                    _flags.push_back(declares("h") ? label("help") : label("help", {"h"}));
+                }
+                _parser.reset(new parser(
+                    schema.number_of_arguments, _options.begin(), _options.end(), _flags.begin(), _flags.end()));
+            });
+            return *_parser;
+        }
+
+        /// handle_command calls the handler of this node, and returns false if it has none.
+        bool handle_command(const routed_command& routed_command) const {
+            if (!_handle_command) {
+                return false;
+            }
+            _handle_command(routed_command);
+            return true;
+        }
+
+        /// try_parse selects a subcommand and parses the command line without throwing (see parser::try_parse).
+        /// Subcommand names must precede the positional arguments of their parent.
+        outcome<routed_command> try_parse(int argc, char* argv[]) const {
+            outcome<routed_command> result{routed_command{{}, command(), this}, {}};
+            std::vector<char*> arguments;
+            std::vector<std::size_t> indices;
+            arguments.reserve(argc > 0 ? static_cast<std::size_t>(argc) : 1);
+            indices.reserve(arguments.capacity());
+            arguments.push_back(argc > 0 ? argv[0] : nullptr);
+            indices.push_back(0);
+            auto node = this;
+            auto is_routing = true;
+            for (auto index = 1; index < argc; ++index) {
+                const slice element(argv[index]);
+                if (is_routing && !node->_subcommands.empty()) {
+                    if (element.size > 0 && element.data[0] == '-') {
+                        const auto name_or_alias_and_parameter = element.size > 1 && element.data[1] == '-' ?
+                                                                     slice(element.data + 2, element.size - 2) :
+                                                                     slice(element.data + 1, element.size - 1);
+                        const auto is_alone = std::find(
+                                                  name_or_alias_and_parameter.data,
+                                                  name_or_alias_and_parameter.data + name_or_alias_and_parameter.size,
+                                                  '=')
+                                              == name_or_alias_and_parameter.data + name_or_alias_and_parameter.size;
+                        match match;
+                        if (is_alone && index + 1 < argc
+                            && node->schema_parser().find(name_or_alias_and_parameter, match) && match.is_option) {
+                            arguments.push_back(argv[index]);
+                            indices.push_back(static_cast<std::size_t>(index));
+                            ++index;
                         }
-                    }
-                    if (!has_equal) {
-                        name_or_alias = name_or_alias_and_parameter;
-                        if (index < argc - 1) {
-                            parameter = std::string(argv[index + 1]);
+                    } else {
+                        const auto child = node->subcommand(element);
+                        if (child != nullptr) {
+                            result.result.path.push_back(element.to_string());
+                            node = child;
+                            continue;
                         }
-                    }
-                    const auto name_and_is_option_candidate = name_to_is_option.find(name_or_alias);
-                    if (name_and_is_option_candidate == name_to_is_option.end()) {
-                        const auto alias_and_name_candidate = alias_to_name.find(name_or_alias);
-                        if (alias_and_name_candidate == alias_to_name.end()) {
-                            throw std::runtime_error("Unknown option name or alias '" + name_or_alias + "'");
+                        if (node->schema_parser().number_of_arguments() == 0) {
+                            result.errors.push_back(error{
+                                error_kind::unknown_subcommand,
+                                static_cast<std::size_t>(index),
+                                element,
+                                slice(),
+                                nullptr,
+                                0});
+                            continue;
                         }
-                        name_and_is_option = name_to_is_option.find(alias_and_name_candidate->second);
-                    } else {
-                        name_and_is_option = name_and_is_option_candidate;
+                        is_routing = false;
                     }
                 }
+                arguments.push_back(argv[index]);
+                indices.push_back(static_cast<std::size_t>(index));
+            }
+            auto parsed = node->schema_parser().try_parse(static_cast<int>(arguments.size()), arguments.data());
+            for (auto error : parsed.errors) {
+                error.index = error.index < indices.size() ? indices[error.index] : static_cast<std::size_t>(argc);
+                result.errors.push_back(error);
+            }
+            std::stable_sort(result.errors.begin(), result.errors.end(), [](const error& first, const error& second) {
+                return first.index < second.index;
+            });
+            result.result.command = std::move(parsed.result);
+            result.result.subcommand = node;
+            return result;
+        }
 
-                if (name_and_is_option->second) {
-                    if (!has_equal) {
-                        if (index == argc - 1) {
-                            throw std::runtime_error(
-                                "The option '" + name_and_is_option->first + "' requires a parameter");
-                        }
-                        ++index;
-                    }
-                    command.options.insert(std::make_pair(name_and_is_option->first, parameter));
-                } else {
-                    if (has_equal) {
-                        throw std::runtime_error(
-                            "The flag '" + name_and_is_option->first + "' does not take a parameter");
-                    }
-                    command.flags.insert(name_and_is_option->first);
-                }
-            } else {
-                if (number_of_arguments >= 0 && static_cast<int64_t>(command.arguments.size()) >= number_of_arguments) {
-                    throw std::runtime_error(
-                        "Too many arguments (" + std::to_string(number_of_arguments) + " expected)");
-                }
-                command.arguments.push_back(element);
+        /// parse selects a subcommand and parses the command line, and throws on the first error.
+        routed_command parse(int argc, char* argv[]) const {
+            auto outcome = try_parse(argc, argv);
+            if (!outcome) {
+                throw_error(outcome.errors.front());
             }
+            return std::move(outcome.result);
         }
-        if (number_of_arguments >= 0 && static_cast<int64_t>(command.arguments.size()) < number_of_arguments) {
-            throw std::runtime_error("Not enough arguments (" + std::to_string(number_of_arguments) + " expected)");
+
+        /// is_materialized determines whether the schema of this node was created.
+        /// It is meant for diagnostics, and must not be called while another thread parses.
+        bool is_materialized() const {
+            return _parser != nullptr;
         }
-        return command;
+
+        protected:
+        typedef std::pair<std::string, std::unique_ptr<command_tree>> subcommand_entry;
+
+        command_tree(const command_tree* parent, make_schema_type make_schema, handle_command_type handle_command) :
+            _parent(parent),
+            _make_schema(std::move(make_schema)),
+            _handle_command(std::move(handle_command)),
+            _has_automatic_help(false) {}
+
+        const command_tree* _parent;
+        make_schema_type _make_schema;
+        handle_command_type _handle_command;
+        std::vector<subcommand_entry> _subcommands;
+        mutable std::once_flag _once;
+        mutable std::vector<label> _options;
+        mutable std::vector<label> _flags;
+        mutable bool _has_automatic_help;
+        mutable std::unique_ptr<parser> _parser;
+    };
+
+    /// static_label represents an option or flag name, and its aliases, known at compile time.
+    /// aliases is a list of aliases separated by single spaces (for example "v verb"), and can be empty.
+    struct static_label {
+        const char* name;
+        const char* aliases;
+        bool is_option;
+        bool is_repeatable;
+    };
+
+    /// static_error reports an invalid static label.
+    /// It is not constexpr, hence a call in a constant expression fails to compile, and a call at run time throws a
+    /// std::logic_error.
+    template <typename Type>
+    inline Type static_error(const char* message) {
+        throw_exception(std::logic_error(message));
+    }
+
+    /// static_is_space determines whether the given character is a white-space in the "C" locale.
+    constexpr bool static_is_space(char character) {
+        return character == ' ' || character == '\t' || character == '\n' || character == '\v' || character == '\f'
+               || character == '\r';
+    }
+
+    /// static_is_end determines whether the given name or alias ends at index.
+    /// Aliases end with either '\0' or a space.
+    constexpr bool static_is_end(const char* name_or_alias, bool is_name, std::size_t index) {
+        return name_or_alias[index] == '\0' || (!is_name && name_or_alias[index] == ' ');
+    }
+
+    /// static_validate is the compile-time counterpart of validate.
+    /// It returns the size of the given name or alias.
+    constexpr std::size_t static_validate(const char* name_or_alias, bool is_name, std::size_t index = 0) {
+        return static_is_end(name_or_alias, is_name, index) ?
+                   (index == 0 ? static_error<std::size_t>("An option or flag name or alias is empty") : index) :
+                   (index == 0 && name_or_alias[0] == '-') ?
+                   static_error<std::size_t>("An option or flag name or alias starts with the character '-'") :
+                   static_is_space(name_or_alias[index]) ?
+                   static_error<std::size_t>("An option or flag name or alias contains white-space characters") :
+                   name_or_alias[index] == '=' ?
+                   static_error<std::size_t>("An option or flag name or alias contains the character '='") :
+                   static_validate(name_or_alias, is_name, index + 1);
+    }
+
+    /// static_validate_aliases calls static_validate on each alias of the given list.
+    constexpr bool static_validate_aliases(const char* aliases, bool is_first = true) {
+        return (is_first && aliases[0] == '\0') ?
+                   true :
+                   aliases[static_validate(aliases, false)] == ' ' ?
+                   static_validate_aliases(aliases + static_validate(aliases, false) + 1, false) :
+                   true;
+    }
+
+    /// static_option creates an option label, and fails to compile if the name or an alias is not valid.
+    constexpr static_label static_option(const char* name, const char* aliases = "") {
+        return static_validate(name, true) > 0 && static_validate_aliases(aliases) ?
+                   static_label{name, aliases, true, false} :
+                   static_error<static_label>("Invalid option");
+    }
+
+    /// static_repeatable_option creates a repeatable option label (see label).
+    constexpr static_label static_repeatable_option(const char* name, const char* aliases = "") {
+        return static_validate(name, true) > 0 && static_validate_aliases(aliases) ?
+                   static_label{name, aliases, true, true} :
+                   static_error<static_label>("Invalid option");
+    }
+
+    /// static_flag creates a flag label, and fails to compile if the name or an alias is not valid.
+    constexpr static_label static_flag(const char* name, const char* aliases = "") {
+        return static_validate(name, true) > 0 && static_validate_aliases(aliases) ?
+                   static_label{name, aliases, false, false} :
+                   static_error<static_label>("Invalid flag");
+    }
+
+    /// static_number_of_aliases returns the number of aliases in the given list.
+    constexpr std::size_t static_number_of_aliases(const char* aliases, std::size_t index = 0) {
+        return aliases[index] == '\0' ? (index == 0 ? 0 : 1) :
+                                        (aliases[index] == ' ' ? 1 : 0) + static_number_of_aliases(aliases, index + 1);
+    }
+
+    /// static_alias returns the alias with the given index in the list (the alias ends with a space or '\0').
+    constexpr const char* static_alias(const char* aliases, std::size_t index) {
+        return index == 0 ? aliases :
+                            static_alias(aliases + static_validate(aliases, false) + 1, index - 1);
+    }
+
+    /// static_entry returns the name (index 0) or an alias (index > 0) of the given label.
+    constexpr const char* static_entry(const static_label& label, std::size_t index) {
+        return index == 0 ? label.name : static_alias(label.aliases, index - 1);
+    }
+
+    /// static_equal compares two names or aliases.
+    constexpr bool static_equal(const char* first, const char* second, std::size_t index = 0) {
+        return static_is_end(first, false, index) ?
+                   static_is_end(second, false, index) :
+                   static_is_end(second, false, index) ? false :
+                   first[index] == second[index] && static_equal(first, second, index + 1);
+    }
+
+    /// static_size returns the number of characters before '\0'.
+    constexpr std::size_t static_size(const char* c_string, std::size_t index = 0) {
+        return c_string[index] == '\0' ? index : static_size(c_string, index + 1);
+    }
+
+    /// static_indices holds a sequence of indices in its template parameters.
+    template <std::size_t... indices>
+    struct static_indices {};
+
+    /// static_concatenate appends the indices of Second, shifted by the size of First, to the indices of First.
+    template <typename First, typename Second>
+    struct static_concatenate;
+    template <std::size_t... first, std::size_t... second>
+    struct static_concatenate<static_indices<first...>, static_indices<second...>> {
+        typedef static_indices<first..., (sizeof...(first) + second)...> type;
+    };
+
+    /// make_static_indices generates the sequence of indices [0, size).
+    /// The sequence is split in halves, so that the depth of template instantiation is logarithmic.
+    template <std::size_t size>
+    struct make_static_indices
+        : static_concatenate<
+              typename make_static_indices<size / 2>::type,
+              typename make_static_indices<size - size / 2>::type> {};
+    template <>
+    struct make_static_indices<0> {
+        typedef static_indices<> type;
+    };
+    template <>
+    struct make_static_indices<1> {
+        typedef static_indices<0> type;
+    };
+
+    /// static_table is a constexpr array, passed by value between the constructors of static_parser.
+    template <typename Type, std::size_t size>
+    struct static_table {
+        Type values[size];
+    };
+
+    /// static_slot_entry returns the name or alias of a slot, or nullptr if the slot is unused.
+    /// Each label has maximum_aliases + 1 consecutive slots: its name, then its aliases.
+    constexpr const char*
+    static_slot_entry(const static_label* labels, std::size_t maximum_aliases, std::size_t slot) {
+        return slot % (maximum_aliases + 1)
+                       > static_number_of_aliases(labels[slot / (maximum_aliases + 1)].aliases) ?
+                   nullptr :
+                   static_entry(labels[slot / (maximum_aliases + 1)], slot % (maximum_aliases + 1));
+    }
+
+    /// static_slot_slice returns the name or alias of a slot as a slice (a null slice if the slot is unused).
+    constexpr slice static_slot_slice(const char* entry) {
+        return entry == nullptr ? slice() : slice(entry, static_validate(entry, false));
+    }
+
+    /// static_compare is the compile-time counterpart of compare.
+    constexpr int static_compare(slice first, slice second, std::size_t index = 0) {
+        return index == first.size ?
+                   (index == second.size ? 0 : -1) :
+                   index == second.size ?
+                   1 :
+                   first.data[index] != second.data[index] ?
+                   (static_cast<unsigned char>(first.data[index]) < static_cast<unsigned char>(second.data[index]) ?
+                        -1 :
+                        1) :
+                   static_compare(first, second, index + 1);
+    }
+
+    /// static_order turns the result of static_compare into a strict order, with a tie-breaker.
+    constexpr bool static_order(int comparison, bool is_less_on_tie) {
+        return comparison < 0 || (comparison == 0 && is_less_on_tie);
+    }
+
+    /// static_slot_less orders slots by name or alias, then by slot index. Unused slots come last.
+    template <std::size_t slots>
+    constexpr bool static_slot_less(const static_table<slice, slots>& entries, std::size_t first, std::size_t second) {
+        return entries.values[second].data == nullptr ?
+                   (entries.values[first].data != nullptr || first < second) :
+                   entries.values[first].data == nullptr ?
+                   false :
+                   static_order(static_compare(entries.values[first], entries.values[second]), first < second);
+    }
+
+    /// static_co_rank returns the number of elements of first among the first rank elements of the merge of first
+    /// and second (both sorted), with a binary search in [begin, end].
+    template <std::size_t slots, std::size_t first_size, std::size_t second_size>
+    constexpr std::size_t static_co_rank(
+        const static_table<slice, slots>& entries,
+        const static_table<std::size_t, first_size>& first,
+        const static_table<std::size_t, second_size>& second,
+        std::size_t rank,
+        std::size_t begin,
+        std::size_t end) {
+        return begin == end ?
+                   begin :
+                   ((begin + end) / 2 >= first_size || rank - (begin + end) / 2 == 0
+                    || static_slot_less(
+                        entries, static_at(second, rank - (begin + end) / 2 - 1), first.values[(begin + end) / 2])) ?
+                   static_co_rank(entries, first, second, rank, begin, (begin + end) / 2) :
+                   static_co_rank(entries, first, second, rank, (begin + end) / 2 + 1, end);
+    }
+
+    /// static_at returns the element of a table at the given index, clamped to the last element, since compilers
+    /// cannot prove that the merge only produces valid indices and warn otherwise.
+    template <std::size_t size>
+    constexpr std::size_t static_at(const static_table<std::size_t, size>& table, std::size_t index) {
+        return table.values[index < size ? index : size - 1];
+    }
+
+    /// static_merged returns the element with the given rank in the merge of first and second, given its co-rank
+    /// (see static_co_rank).
+    template <std::size_t slots, std::size_t first_size, std::size_t second_size>
+    constexpr std::size_t static_merged(
+        const static_table<slice, slots>& entries,
+        const static_table<std::size_t, first_size>& first,
+        const static_table<std::size_t, second_size>& second,
+        std::size_t rank,
+        std::size_t co_rank) {
+        return co_rank < first_size
+                       && (rank - co_rank >= second_size
+                           || static_slot_less(entries, first.values[co_rank], static_at(second, rank - co_rank))) ?
+                   first.values[co_rank] :
+                   static_at(second, rank - co_rank);
+    }
+
+    /// static_merge merges two sorted tables of slots. Each element is computed independently from its co-rank, so
+    /// that the merge is a pack expansion.
+    template <std::size_t slots, std::size_t first_size, std::size_t second_size, std::size_t... ranks>
+    constexpr static_table<std::size_t, first_size + second_size> static_merge(
+        const static_table<slice, slots>& entries,
+        const static_table<std::size_t, first_size>& first,
+        const static_table<std::size_t, second_size>& second,
+        static_indices<ranks...>) {
+        return static_table<std::size_t, first_size + second_size>{{static_merged(
+            entries,
+            first,
+            second,
+            ranks,
+            static_co_rank(
+                entries,
+                first,
+                second,
+                ranks,
+                ranks > second_size ? ranks - second_size : 0,
+                ranks < first_size ? ranks : first_size))...}};
+    }
+
+    /// static_sorter sorts size slots from begin with a merge sort (see static_slot_less).
+    template <std::size_t size>
+    struct static_sorter {
+        template <std::size_t slots>
+        static constexpr static_table<std::size_t, size>
+        sort(const static_table<slice, slots>& entries, std::size_t begin) {
+            return static_merge(
+                entries,
+                static_sorter<size / 2>::sort(entries, begin),
+                static_sorter<size - size / 2>::sort(entries, begin + size / 2),
+                typename make_static_indices<size>::type());
+        }
+    };
+    template <>
+    struct static_sorter<1> {
+        template <std::size_t slots>
+        static constexpr static_table<std::size_t, 1> sort(const static_table<slice, slots>&, std::size_t begin) {
+            return static_table<std::size_t, 1>{{begin}};
+        }
+    };
+
+    /// static_count returns the number of used slots in [begin, end).
+    template <std::size_t slots>
+    constexpr std::size_t
+    static_count(const static_table<slice, slots>& entries, std::size_t begin = 0, std::size_t end = slots) {
+        return end - begin == 1 ? (entries.values[begin].data == nullptr ? 0 : 1) :
+                                  static_count(entries, begin, begin + (end - begin) / 2)
+                                      + static_count(entries, begin + (end - begin) / 2, end);
+    }
+
+    /// static_check_sorted throws if two consecutive sorted entries in [begin, end) are equal, that is, if two labels
+    /// share a name or an alias.
+    template <std::size_t slots>
+    constexpr bool static_check_sorted(
+        const static_table<slice, slots>& sorted,
+        std::size_t begin = 0,
+        std::size_t end = slots - 1) {
+        return end - begin == 0 ?
+                   true :
+                   end - begin == 1 ?
+                   (sorted.values[begin + 1].data != nullptr
+                            && static_compare(sorted.values[begin], sorted.values[begin + 1]) == 0 ?
+                        static_error<bool>("Duplicated name or alias") :
+                        true) :
+                   static_check_sorted(sorted, begin, begin + (end - begin) / 2)
+                       && static_check_sorted(sorted, begin + (end - begin) / 2, end);
+    }
+
+    /// static_check_aliases throws if a label in [begin, end) has more than maximum_aliases aliases.
+    constexpr bool static_check_aliases(
+        const static_label* labels,
+        std::size_t maximum_aliases,
+        std::size_t begin,
+        std::size_t end) {
+        return end - begin == 1 ?
+                   (static_number_of_aliases(labels[begin].aliases) > maximum_aliases ?
+                        static_error<bool>("Too many aliases (see maximum_aliases)") :
+                        true) :
+                   static_check_aliases(labels, maximum_aliases, begin, begin + (end - begin) / 2)
+                       && static_check_aliases(labels, maximum_aliases, begin + (end - begin) / 2, end);
+    }
+
+    /// static_parser is a parser whose options and flags are validated at compile time.
+    /// The labels must have static storage duration, for example:
+    ///     constexpr pontella::static_label labels[] = {
+    ///         pontella::static_option("verbose", "v"),
+    ///         pontella::static_flag("help", "h"),
+    ///     };
+    ///     constexpr auto parser = pontella::make_static_parser(labels, 1);
+    /// The id of each label is its index in the labels array.
+    /// The names and aliases are sorted at compile time, and lookups are binary searches that do not allocate memory.
+    /// Each label has room for maximum_aliases aliases in the sorted table, and a label with more aliases fails to
+    /// compile. The checks and the sort split the labels in halves, so that the depth of constexpr evaluation is
+    /// logarithmic in the number of labels.
+    template <std::size_t number_of_labels, std::size_t maximum_aliases = 3>
+    class static_parser : public parser_methods<static_parser<number_of_labels, maximum_aliases>> {
+        public:
+        /// slots is the size of the sorted table of names and aliases.
+        static constexpr std::size_t slots = number_of_labels * (maximum_aliases + 1);
+
+        /// If number_of_arguments is negative, the number of arguments is unlimited.
+        constexpr static_parser(const static_label (&labels)[number_of_labels], int64_t number_of_arguments) :
+            static_parser(
+                labels,
+                number_of_arguments,
+                typename make_static_indices<number_of_labels>::type(),
+                typename make_static_indices<slots>::type()) {}
+        static_parser(const static_parser&) = default;
+        static_parser(static_parser&&) = default;
+        static_parser& operator=(const static_parser&) = default;
+        static_parser& operator=(static_parser&&) = default;
+
+        /// find retrieves the option or flag associated with a name or alias.
+        bool find(slice name_or_alias, match& match) const {
+            const auto entries_end = _entries + _number_of_entries;
+            const auto entry =
+                std::lower_bound(_entries, entries_end, name_or_alias, [](const slice& entry, const slice& name) {
+                    return compare(entry, name) < 0;
+                });
+            if (entry == entries_end || compare(*entry, name_or_alias) != 0) {
+                return false;
+            }
+            const auto id = _ids[entry - _entries];
+            match.is_option = _labels[id].is_option;
+            match.id = id;
+            match.is_repeatable = _labels[id].is_repeatable;
+            match.name = _names[id];
+            match.type = nullptr;
+            match.is_ambiguous = false;
+            return true;
+        }
+
+        /// name returns the name of the label with the given id.
+        constexpr slice name(std::size_t id) const {
+            return _names[id];
+        }
+
+        /// names returns a pointer to the name of each label.
+        constexpr const slice* names() const {
+            return _names;
+        }
+
+        /// size returns the number of labels.
+        constexpr std::size_t size() const {
+            return number_of_labels;
+        }
+
+        /// number_of_arguments returns the expected number of positional arguments (negative if unlimited).
+        constexpr int64_t number_of_arguments() const {
+            return _number_of_arguments;
+        }
+
+        /// arguments_type returns nullptr, since static labels have no parameter types.
+        constexpr const parameter_type* arguments_type() const {
+            return nullptr;
+        }
+
+        /// path_threads returns 1, since static labels have no paths to check.
+        constexpr std::size_t path_threads() const {
+            return 1;
+        }
+
+        /// path_check returns nullptr, since static labels have no paths to check.
+        constexpr pontella::path_check path_check() const {
+            return nullptr;
+        }
+
+        protected:
+        /// The constructors compute, in turn, the entry of each slot and the order of the slots.
+        template <std::size_t... indices, std::size_t... slot_indices>
+        constexpr static_parser(
+            const static_label (&labels)[number_of_labels],
+            int64_t number_of_arguments,
+            static_indices<indices...> label_indices,
+            static_indices<slot_indices...> slot_sequence) :
+            static_parser(
+                labels,
+                number_of_arguments,
+                label_indices,
+                slot_sequence,
+                static_table<slice, slots>{
+                    {static_slot_slice(static_slot_entry(labels, maximum_aliases, slot_indices))...}}) {}
+        template <std::size_t... indices, std::size_t... slot_indices>
+        constexpr static_parser(
+            const static_label (&labels)[number_of_labels],
+            int64_t number_of_arguments,
+            static_indices<indices...> label_indices,
+            static_indices<slot_indices...> slot_sequence,
+            const static_table<slice, slots>& entries) :
+            static_parser(
+                labels,
+                number_of_arguments,
+                label_indices,
+                slot_sequence,
+                entries,
+                static_sorter<slots>::sort(entries, 0)) {}
+        template <std::size_t... indices, std::size_t... slot_indices>
+        constexpr static_parser(
+            const static_label (&labels)[number_of_labels],
+            int64_t number_of_arguments,
+            static_indices<indices...>,
+            static_indices<slot_indices...>,
+            const static_table<slice, slots>& entries,
+            const static_table<std::size_t, slots>& order) :
+            _labels(
+                static_check_aliases(labels, maximum_aliases, 0, number_of_labels)
+                        && static_check_sorted(
+                            static_table<slice, slots>{{entries.values[order.values[slot_indices]]...}}) ?
+                    labels :
+                    nullptr),
+            _names{slice(labels[indices].name, static_size(labels[indices].name))...},
+            _entries{entries.values[order.values[slot_indices]]...},
+            _ids{(order.values[slot_indices] / (maximum_aliases + 1))...},
+            _number_of_entries(static_count(entries)),
+            _number_of_arguments(number_of_arguments) {}
+
+        const static_label* _labels;
+        slice _names[number_of_labels];
+        slice _entries[slots];
+        std::size_t _ids[slots];
+        std::size_t _number_of_entries;
+        int64_t _number_of_arguments;
+    };
+
+    /// make_static_parser creates a static_parser and deduces the number of labels.
+    /// maximum_aliases can be given explicitly, for example make_static_parser<5>(labels, 1).
+    template <std::size_t maximum_aliases = 3, std::size_t number_of_labels>
+    constexpr static_parser<number_of_labels, maximum_aliases>
+    make_static_parser(const static_label (&labels)[number_of_labels], int64_t number_of_arguments) {
+        return static_parser<number_of_labels, maximum_aliases>(labels, number_of_arguments);
+    }
+
+    /// parse turns argc and argv into parsed arguments and options.
+    /// If number_of_arguments is negative, the number of arguments is unlimited.
+    template <typename OptionIterator, typename FlagIterator>
+    inline command parse(
+        int argc,
+        char* argv[],
+        int64_t number_of_arguments,
+        OptionIterator options_begin,
+        OptionIterator options_end,
+        FlagIterator flags_begin,
+        FlagIterator flags_end) {
+        return parser(number_of_arguments, options_begin, options_end, flags_begin, flags_end).parse(argc, argv);
     }
     template <typename OptionIterator>
     inline command parse(
@@ -203,29 +4671,71 @@ namespace pontella {
         return parse(argc, argv, number_of_arguments, options.begin(), options.end(), flags.begin(), flags.end());
     }
 
+    /// test_flags determines which of the given flags were used, with a single pass over argv.
+    /// present must be a random access iterator to one boolean per flag, set to true if the flag was used.
+    /// Scanning stops at the end-of-options marker "--", and ends early once every flag was found.
+    /// It does not allocate memory.
+    template <typename FlagIterator, typename PresentIterator>
+    inline void test_flags(
+        int argc,
+        char* argv[],
+        FlagIterator flags_begin,
+        FlagIterator flags_end,
+        PresentIterator present) {
+        std::size_t remaining = 0;
+        for (auto flag = flags_begin; flag != flags_end; ++flag) {
+            validate(flag->name, false, true);
+            for (const auto& alias : flag->aliases) {
+                validate(alias, false, false);
+            }
+            present[remaining] = false;
+            ++remaining;
+        }
+        for (auto index = 1; index < argc && remaining > 0; ++index) {
+            const slice element(argv[index]);
+            if (element.size < 2 || element.data[0] != '-') {
+                continue;
+            }
+            if (element.size == 2 && element.data[1] == '-') {
+                break;
+            }
+            const auto name_or_alias = element.data[1] == '-' ? slice(element.data + 2, element.size - 2) :
+                                                                slice(element.data + 1, element.size - 1);
+            std::size_t flag_index = 0;
+            for (auto flag = flags_begin; flag != flags_end; ++flag, ++flag_index) {
+                if (present[flag_index]) {
+                    continue;
+                }
+                auto found = compare(slice(flag->name), name_or_alias) == 0;
+                for (auto alias = flag->aliases.begin(); !found && alias != flag->aliases.end(); ++alias) {
+                    found = compare(slice(*alias), name_or_alias) == 0;
+                }
+                if (found) {
+                    present[flag_index] = true;
+                    --remaining;
+                }
+            }
+        }
+    }
+
+    /// test_flags determines which of the given flags were used, and returns one boolean per flag.
+    inline std::vector<bool> test_flags(int argc, char* argv[], std::initializer_list<label> flags) {
+        std::vector<bool> present(flags.size(), false);
+        test_flags(argc, argv, flags.begin(), flags.end(), present.begin());
+        return present;
+    }
+
     /// test determines wether the given flag was used.
     /// It can be used to hide the error message when a specific flag is present.
     inline bool test(int argc, char* argv[], const label& flag) {
-        std::unordered_set<std::string> patterns;
-        validate(flag.name, false, true);
-        patterns.insert(std::string("-") + flag.name);
-        patterns.insert(std::string("--") + flag.name);
-        for (const auto& alias : flag.aliases) {
-            validate(alias, false, false);
-            patterns.insert(std::string("-") + alias);
-            patterns.insert(std::string("--") + alias);
-        }
-        return std::any_of(patterns.begin(), patterns.end(), [&](const std::string& pattern) {
-            for (auto index = 1; index < argc; ++index) {
-                if (pattern == std::string(argv[index])) {
-                    return true;
-                }
-            }
-            return false;
-        });
+        auto present = false;
+        test_flags(argc, argv, &flag, &flag + 1, &present);
+        return present;
     }
 
     /// main wraps error handling and message display.
+    /// Every error in the command line is displayed, and exceptions thrown by handle_command are caught.
+    /// Errors in the labels (std::logic_error) are displayed even if help is requested.
     template <typename HandleCommand>
     inline int main(
         std::initializer_list<std::string> lines,
@@ -236,20 +4746,74 @@ namespace pontella {
         std::initializer_list<label> flags,
         HandleCommand handle_command) {
         const label help{"help", {"h"}};
+#ifdef PONTELLA_EXCEPTIONS
         try {
+#endif
             std::vector<label> flags_with_help(flags);
             flags_with_help.push_back(help);
-            const auto command =
-                parse(argc, argv, number_of_arguments, options, flags_with_help.begin(), flags_with_help.end());
-            if (command.flags.find("help") == command.flags.end()) {
-                handle_command(command);
-                return 0;
+            const auto outcome = parser(number_of_arguments, options, flags_with_help.begin(), flags_with_help.end())
+                                     .try_parse(argc, argv);
+            if (outcome) {
+                if (outcome.result.flags.find("help") == outcome.result.flags.end()) {
+                    handle_command(outcome.result);
+                    return 0;
+                }
+            } else if (!test(argc, argv, help)) {
+                for (const auto& error : outcome.errors) {
+                    std::cerr << describe(error) << "\n";
+                }
+            }
+#ifdef PONTELLA_EXCEPTIONS
+        } catch (const std::logic_error& exception) {
+            std::cerr << exception.what() << "\n";
+        } catch (const std::exception& exception) {
+            if (!test(argc, argv, help)) {
+                std::cerr << exception.what() << "\n";
+            }
+        }
+#endif
+        for (const auto& line : lines) {
+            std::cerr << line << "\n";
+        }
+        return 1;
+    }
+
+    /// main wraps error handling and message display for a program with subcommands, and calls the handler of the
+    /// selected subcommand. The flag help (alias h) is declared by the root of the tree and inherited by every
+    /// subcommand (see command_tree), and shows the message. The alias h is recognized only by the subcommands that
+    /// keep it.
+    inline int main(std::initializer_list<std::string> lines, int argc, char* argv[], const command_tree& tree) {
+        label help{"help"};
+#ifdef PONTELLA_EXCEPTIONS
+        try {
+#endif
+            const auto outcome = tree.try_parse(argc, argv);
+            match match;
+            if (outcome.result.subcommand->schema_parser().find("h", match) && !match.is_option
+                && compare(match.name, slice("help")) == 0) {
+                help.aliases.insert("h");
+            }
+            if (outcome) {
+                if (outcome.result.command.flags.find("help") == outcome.result.command.flags.end()) {
+                    if (outcome.result.subcommand->handle_command(outcome.result)) {
+                        return 0;
+                    }
+                    std::cerr << "A subcommand is required\n";
+                }
+            } else if (!test(argc, argv, help)) {
+                for (const auto& error : outcome.errors) {
+                    std::cerr << describe(error) << "\n";
+                }
             }
+#ifdef PONTELLA_EXCEPTIONS
+        } catch (const std::logic_error& exception) {
+            std::cerr << exception.what() << "\n";
         } catch (const std::exception& exception) {
             if (!test(argc, argv, help)) {
                 std::cerr << exception.what() << "\n";
             }
         }
+#endif
         for (const auto& line : lines) {
             std::cerr << line << "\n";
         }
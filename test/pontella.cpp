@@ -1,6 +1,11 @@
 #define CATCH_CONFIG_MAIN
 #include "../source/pontella.hpp"
 #include "../third_party/Catch2/single_include/catch.hpp"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
 
 TEST_CASE("Parse a valid command line", "[parse]") {
     for (const auto& first_option_parts : std::vector<std::vector<const char*>>({
@@ -164,6 +169,1020 @@ TEST_CASE("Fail on unexpected characters", "[parse]") {
     }
 }
 
+TEST_CASE("Parse several command lines with a shared parser", "[parser]") {
+    const pontella::parser parser(1, {{"verbose", {"v"}}}, {{"help", {"h"}}});
+    std::vector<uint8_t> successes(4, 0);
+    std::vector<std::thread> threads;
+    for (std::size_t thread_index = 0; thread_index < successes.size(); ++thread_index) {
+        threads.emplace_back([&, thread_index]() {
+            auto success = true;
+            for (std::size_t repetition = 0; repetition < 100; ++repetition) {
+                std::vector<const char*> arguments{"./program", "input.log", "-v", "1", "--help"};
+                const auto command =
+                    parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+                success &= command.arguments.size() == 1 && command.options.at("verbose") == "1"
+                           && command.flags.find("help") != command.flags.end();
+            }
+            successes[thread_index] = success ? 1 : 0;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(std::all_of(successes.begin(), successes.end(), [](uint8_t success) { return success == 1; }));
+    std::vector<const char*> arguments{"./program", "input.log", "--unknown"};
+    REQUIRE_THROWS_AS(
+        parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data())), std::runtime_error);
+}
+
+TEST_CASE("Parse a command line without copies", "[command_view]") {
+    const pontella::parser parser(-1, {{"verbose", {"v"}}, {"output", {"o"}}}, {{"help", {"h"}}});
+    std::vector<const char*> arguments{"./program", "a.log", "-v=1", "b.log", "--output", "c.log", "-h"};
+    const auto command_view =
+        parser.parse_view(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    REQUIRE(command_view.arguments.size() == 2);
+    REQUIRE(command_view.arguments[0].data == arguments[1]);
+    REQUIRE(command_view.arguments[1].to_string() == "b.log");
+    REQUIRE(command_view.options.size() == 3);
+    REQUIRE(parser.id("verbose") == 0);
+    REQUIRE(parser.id("o") == 1);
+    REQUIRE(parser.id("help") == 2);
+    REQUIRE(command_view.has_option(0));
+    REQUIRE(command_view.options[0].data == arguments[2] + 3);
+    REQUIRE(command_view.options[0].size == 1);
+    REQUIRE(command_view.options[1].data == arguments[5]);
+    REQUIRE(!command_view.has_option(2));
+    REQUIRE(command_view.flags == std::vector<bool>({false, false, true}));
+    REQUIRE(command_view.option("output").to_string() == "c.log");
+    REQUIRE(command_view.option("unknown").data == nullptr);
+    REQUIRE(command_view.flag("help"));
+    REQUIRE_THROWS_AS(parser.id("unknown"), std::logic_error);
+    const auto command = command_view.to_command();
+    REQUIRE(command.arguments == std::vector<std::string>({"a.log", "b.log"}));
+    REQUIRE(command.options.at("verbose") == "1");
+    REQUIRE(command.options.at("output") == "c.log");
+    REQUIRE(command.flags.find("help") != command.flags.end());
+}
+
+TEST_CASE("Match prefixes and suggest names", "[parser]") {
+    pontella::parser parser(
+        0, {{"verbose", {"v", "verb"}}, {"version-file"}, {"output", {"o"}}}, {{"help", {"h"}}, {"overwrite"}});
+    pontella::match match;
+    REQUIRE(parser.find("verb", match));
+    REQUIRE(match.name.to_string() == "verbose");
+    REQUIRE(!parser.find("verbo", match));
+    REQUIRE(match.name.to_string() == "verbose");
+    REQUIRE(!parser.find("outpt", match));
+    REQUIRE(match.name.to_string() == "output");
+    REQUIRE(!parser.find("xyz", match));
+    REQUIRE(match.name.data == nullptr);
+    parser.allow_prefixes();
+    REQUIRE(parser.find("verbo", match));
+    REQUIRE(match.name.to_string() == "verbose");
+    REQUIRE(parser.find("version-", match));
+    REQUIRE(match.name.to_string() == "version-file");
+    REQUIRE(parser.find("ov", match));
+    REQUIRE(match.name.to_string() == "overwrite");
+    REQUIRE(parser.find("o", match));
+    REQUIRE(match.name.to_string() == "output");
+    REQUIRE(!parser.find("ver", match));
+    REQUIRE(match.is_ambiguous);
+    REQUIRE(match.name.to_string() == "verb', 'verbose', 'version-file");
+    REQUIRE(parser.find("he", match));
+    REQUIRE(match.name.to_string() == "help");
+    REQUIRE(!parser.find("", match));
+    {
+        auto single_parser = pontella::parser(0, {{"verbose", {"v"}}}, {});
+        single_parser.allow_prefixes();
+        for (const auto empty : {"--=3", "-=3"}) {
+            std::vector<const char*> empty_arguments{"./program", empty};
+            REQUIRE_THROWS_AS(
+                single_parser.parse(
+                    static_cast<int>(empty_arguments.size()), const_cast<char**>(empty_arguments.data())),
+                std::runtime_error);
+        }
+    }
+    {
+        auto ambiguous_parser = pontella::parser(0, {{"verbose", {"v"}}, {"version", {"V"}}}, {});
+        ambiguous_parser.allow_prefixes();
+        std::vector<const char*> ambiguous_arguments{"./program", "--ver=1", "--verbo=2"};
+        const auto outcome = ambiguous_parser.try_parse(
+            static_cast<int>(ambiguous_arguments.size()), const_cast<char**>(ambiguous_arguments.data()));
+        REQUIRE(outcome.errors.size() == 1);
+        REQUIRE(outcome.errors[0].kind == pontella::error_kind::ambiguous_name);
+        REQUIRE(outcome.errors[0].index == 1);
+        REQUIRE(
+            pontella::describe(outcome.errors[0])
+            == "Ambiguous option name or alias 'ver' (it could be 'verbose', 'version')");
+        REQUIRE(outcome.result.options.at("verbose") == "2");
+        REQUIRE(!ambiguous_parser.find("x", match));
+        REQUIRE(!match.is_ambiguous);
+    }
+    std::vector<const char*> arguments{"./program", "--overwrit"};
+    parser.allow_prefixes(false);
+    REQUIRE_THROWS_WITH(
+        parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data())),
+        "Unknown option name or alias 'overwrit' (did you mean 'overwrite'?)");
+    std::vector<pontella::label> options;
+    for (std::size_t index = 0; index < 5000; ++index) {
+        options.emplace_back(
+            "plugin-" + std::to_string(index), std::unordered_set<std::string>{"p" + std::to_string(index)});
+    }
+    const std::vector<pontella::label> flags;
+    const pontella::parser plugins_parser(0, options.begin(), options.end(), flags.begin(), flags.end());
+    REQUIRE(plugins_parser.find("p4321", match));
+    REQUIRE(match.id == 4321);
+    REQUIRE(!plugins_parser.find("plugin-4321x", match));
+    REQUIRE(match.name.to_string() == "plugin-4321");
+    const std::string long_name(60, 'p');
+    const pontella::parser long_parser(0, {{long_name}}, {});
+    REQUIRE(!long_parser.find(long_name.substr(1) + "x", match));
+    REQUIRE(match.name.to_string() == long_name);
+}
+
+TEST_CASE("Observe the parse phases", "[observed_parser]") {
+    const std::vector<pontella::label> options{{"output", {"o"}}};
+    const std::vector<pontella::label> flags{{"verbose", {"v"}}};
+    pontella::statistics statistics;
+    const pontella::parser parser(-1, options.begin(), options.end(), flags.begin(), flags.end(), statistics);
+    std::vector<std::string> trace;
+    statistics.trace = [&](pontella::slice token) { trace.push_back(token.to_string()); };
+    const auto observed = pontella::observe(parser, statistics);
+    std::vector<const char*> arguments{"./program", "input", "-o", "output", "--verbose", "--unknown"};
+    const auto outcome = observed.try_parse(
+        static_cast<int>(arguments.size()),
+        const_cast<char**>(arguments.data()),
+        pontella::observed_allocator<char, pontella::statistics>(statistics));
+    REQUIRE(outcome.errors.size() == 1);
+    REQUIRE(outcome.result.options.size() == 1);
+    REQUIRE(outcome.result.options.begin()->second == "output");
+    REQUIRE(outcome.result.flags.size() == 1);
+    REQUIRE(trace == (std::vector<std::string>{"input", "-o", "output", "--verbose", "--unknown"}));
+    REQUIRE(statistics.tokens == 5);
+    REQUIRE(statistics.lookups == 3);
+    REQUIRE(statistics.misses == 1);
+    REQUIRE(statistics.allocations > 0);
+    REQUIRE(statistics.allocated_bytes > 0);
+    REQUIRE(statistics.duration(pontella::phase::validation).count() > 0);
+    REQUIRE(statistics.duration(pontella::phase::construction).count() > 0);
+    REQUIRE(statistics.duration(pontella::phase::lookup).count() >= 0);
+    std::size_t count = 0;
+    observed.visit(
+        static_cast<int>(arguments.size()) - 1,
+        const_cast<char**>(arguments.data()),
+        [&](pontella::slice) { ++count; },
+        [&](const pontella::match&, pontella::slice) { ++count; },
+        [&](const pontella::match&) { ++count; });
+    REQUIRE(count == 3);
+    REQUIRE(statistics.tokens == 9);
+    REQUIRE(statistics.lookups == 5);
+}
+
+TEST_CASE("Complete a partial command line", "[parser]") {
+    const pontella::parser parser(
+        1,
+        {{"output", {"o"}}, {"mode", {"m"}, pontella::enumeration({"fast", "faster", "slow"})}},
+        {{"help", {"h"}}, {"overwrite"}});
+    const auto complete = [&](std::vector<const char*> arguments, int index) {
+        return parser.complete(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()), index);
+    };
+    auto completion = complete({"./program", "--o"}, 1);
+    REQUIRE(completion.kind == pontella::completion_kind::name);
+    REQUIRE(completion.candidates == (std::vector<std::string>{"--o", "--output", "--overwrite"}));
+    completion = complete({"./program", "-"}, 1);
+    REQUIRE(completion.candidates
+            == (std::vector<std::string>{"--help", "--mode", "--output", "--overwrite", "-h", "-m", "-o"}));
+    completion = complete({"./program", "-m", "fa"}, 2);
+    REQUIRE(completion.kind == pontella::completion_kind::choice);
+    REQUIRE(completion.candidates == (std::vector<std::string>{"fast", "faster"}));
+    completion = complete({"./program", "--mode=s"}, 1);
+    REQUIRE(completion.candidates == (std::vector<std::string>{"--mode=slow"}));
+    completion = complete({"./program", "-o"}, 2);
+    REQUIRE(completion.kind == pontella::completion_kind::parameter);
+    completion = complete({"./program", "-o", "file", "-h"}, 4);
+    REQUIRE(completion.kind == pontella::completion_kind::argument);
+    REQUIRE(completion.argument_index == 0);
+    completion = complete({"./program", "input", ""}, 2);
+    REQUIRE(completion.kind == pontella::completion_kind::name);
+    REQUIRE(completion.candidates.size() == 7);
+    completion = complete({"./program", "input", "x"}, 2);
+    REQUIRE(completion.kind == pontella::completion_kind::none);
+    const auto bash = parser.completion_script(pontella::shell::bash, "program");
+    REQUIRE(bash.find("'--mode'|'-mode'|'--m'|'-m') COMPREPLY=($(compgen -W 'fast faster slow'") != std::string::npos);
+    REQUIRE(bash.find("complete -o default -F _pontella_program 'program'") != std::string::npos);
+    const auto zsh = parser.completion_script(pontella::shell::zsh, "program");
+    REQUIRE(zsh.find("compadd -- 'fast' 'faster' 'slow';") != std::string::npos);
+    const auto fish = parser.completion_script(pontella::shell::fish, "program");
+    REQUIRE(fish.find("complete -c 'program' -l 'mode' -s 'm' -x -a 'fast faster slow'\n") != std::string::npos);
+    REQUIRE(fish.find("complete -c 'program' -l 'overwrite'\n") != std::string::npos);
+}
+
+TEST_CASE("Fail on a name equal to the alias of a previous option", "[parser]") {
+    REQUIRE_THROWS_AS(pontella::parser(0, {{"hidden", {"h"}}}, {{"h", {}}}), std::logic_error);
+    REQUIRE_THROWS_WITH(pontella::parser(0, {{"hidden", {"h"}}}, {{"h", {}}}), "Duplicated name and alias 'h'");
+    REQUIRE_THROWS_WITH(pontella::parser(0, {{"hidden", {"h"}}}, {{"help", {"h"}}}), "Duplicated alias 'h'");
+    REQUIRE_THROWS_WITH(pontella::parser(0, {{"hidden", {}}}, {{"hidden", {}}}), "Duplicated name 'hidden'");
+}
+
+TEST_CASE("Parse command lines with an arena", "[arena]") {
+    const pontella::parser parser(-1, {{"verbose", {"v"}}}, {{"help", {"h"}}});
+    pontella::arena arena(1 << 12);
+    const pontella::arena_allocator<char> allocator(arena);
+    typedef pontella::basic_command<pontella::arena_allocator<char>>::string string;
+    std::vector<const char*> arguments{
+        "./program", "a-long-argument-that-does-not-fit-in-a-small-string.log", "-v", "1", "--help"};
+    std::size_t capacity = 0;
+    for (std::size_t repetition = 0; repetition < 16; ++repetition) {
+        arena.reset();
+        {
+            const auto command =
+                parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()), allocator);
+            REQUIRE(command.arguments.size() == 1);
+            REQUIRE(command.arguments.front() == arguments[1]);
+            REQUIRE(command.options.at(string("verbose", allocator)) == "1");
+            REQUIRE(command.flags.find(string("help", allocator)) != command.flags.end());
+            const auto command_view = parser.parse_view(
+                static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()), allocator);
+            REQUIRE(command_view.flags[parser.id("help")]);
+            REQUIRE(command_view.to_command(allocator).options.at(string("verbose", allocator)) == "1");
+        }
+        if (repetition == 0) {
+            capacity = arena.capacity();
+        }
+        REQUIRE(arena.capacity() == capacity);
+    }
+}
+
+TEST_CASE("Visit a long command line", "[visit]") {
+    const pontella::parser parser(-1, {{"verbose", {"v"}}}, {{"help", {"h"}}});
+    std::vector<std::string> paths;
+    for (std::size_t index = 0; index < 100000; ++index) {
+        paths.push_back(std::to_string(index) + ".log");
+    }
+    std::vector<const char*> arguments{"./program", "-v", "2"};
+    for (const auto& path : paths) {
+        arguments.push_back(path.c_str());
+    }
+    arguments.push_back("--help");
+    std::size_t next_argument = 0;
+    auto ordered = true;
+    std::string verbose;
+    auto help = false;
+    parser.visit(
+        static_cast<int>(arguments.size()),
+        const_cast<char**>(arguments.data()),
+        [&](pontella::slice argument) {
+            ordered &= argument.data == paths[next_argument].c_str();
+            ++next_argument;
+        },
+        [&](const pontella::match& match, pontella::slice parameter) {
+            ordered &= next_argument == 0 && match.id == 0;
+            verbose = parameter.to_string();
+        },
+        [&](const pontella::match& match) {
+            ordered &= next_argument == paths.size();
+            help = match.name.to_string() == "help";
+        });
+    REQUIRE(ordered);
+    REQUIRE(next_argument == paths.size());
+    REQUIRE(verbose == "2");
+    REQUIRE(help);
+    const pontella::parser bounded_parser(2, {}, {});
+    REQUIRE_THROWS_AS(
+        bounded_parser.visit(
+            static_cast<int>(arguments.size()),
+            const_cast<char**>(arguments.data()),
+            [](pontella::slice) {},
+            [](const pontella::match&, pontella::slice) {},
+            [](const pontella::match&) {}),
+        std::runtime_error);
+}
+
+TEST_CASE("Push tokens and bytes to an incremental parser", "[incremental_parser]") {
+    const pontella::parser parser(
+        1, {{"output", {"o"}}, {"level", {"l"}, pontella::integer(0, 3)}}, {{"help", {"h"}}});
+    std::vector<std::string> events;
+    auto incremental_parser = pontella::make_incremental_parser(
+        parser,
+        [&](pontella::slice argument) { events.push_back("argument " + argument.to_string()); },
+        [&](const pontella::match& match, pontella::slice parameter) {
+            events.push_back("option " + match.name.to_string() + " " + parameter.to_string());
+        },
+        [&](const pontella::match& match) { events.push_back("flag " + match.name.to_string()); },
+        [&](const pontella::error& error) { events.push_back("error " + pontella::describe(error)); });
+    incremental_parser.push("-o");
+    REQUIRE(incremental_parser.is_awaiting_parameter());
+    REQUIRE(events.empty());
+    incremental_parser.push("out.txt");
+    incremental_parser.push("input");
+    incremental_parser.push("-h");
+    incremental_parser.push("--level=7");
+    incremental_parser.finish();
+    REQUIRE(
+        events
+        == (std::vector<std::string>{
+            "option output out.txt",
+            "argument input",
+            "flag help",
+            "error The option 'level' expects an integer in the range [0, 3] (got '7')"}));
+    events.clear();
+    incremental_parser.push_bytes("--lev");
+    incremental_parser.push_bytes("el=2 in");
+    REQUIRE(events == std::vector<std::string>{"option level 2"});
+    incremental_parser.push_bytes("put 'a b");
+    incremental_parser.push_bytes("c\\' \"d\\\"\" -o");
+    incremental_parser.finish();
+    REQUIRE(
+        events
+        == (std::vector<std::string>{
+            "option level 2",
+            "argument input",
+            "error Too many arguments (1 expected)",
+            "error Too many arguments (1 expected)",
+            "error The option 'output' requires a parameter"}));
+    REQUIRE(incremental_parser.index() == 0);
+    events.clear();
+    incremental_parser.push_bytes("input \"unterminated");
+    incremental_parser.finish();
+    REQUIRE(events == (std::vector<std::string>{"argument input", "error Unterminated quote in '\"unterminated'"}));
+    auto throwing_parser = pontella::make_incremental_parser(
+        parser, [](pontella::slice) {}, [](const pontella::match&, pontella::slice) {}, [](const pontella::match&) {});
+    REQUIRE_THROWS_WITH(throwing_parser.push("--unknown"), "Unknown option name or alias 'unknown'");
+    const pontella::parser arguments_parser(-1, {}, {});
+    for (const std::string text : {
+             "a\"b\\\nc\"d",
+             "plain  'x y'\t\"q\\$\\`\\\"\\\\\\n\" e\\ f",
+             "x\\\ny z\n",
+             "'' \"\" mixed'a'\"b\"c\\d",
+             "tail\\",
+             "a \\\n    b",
+             "a \\",
+         }) {
+        std::vector<std::string> expected;
+        {
+            std::vector<pontella::slice> tokens;
+            std::deque<std::string> storage;
+            pontella::slice unterminated;
+            REQUIRE(pontella::tokenize_line(text, tokens, storage, unterminated));
+            for (const auto& token : tokens) {
+                expected.push_back(token.to_string());
+            }
+        }
+        for (const std::size_t chunk_size : {text.size(), static_cast<std::size_t>(1), static_cast<std::size_t>(3)}) {
+            std::vector<std::string> pushed;
+            auto bytes_parser = pontella::make_incremental_parser(
+                arguments_parser,
+                [&](pontella::slice argument) { pushed.push_back(argument.to_string()); },
+                [](const pontella::match&, pontella::slice) {},
+                [](const pontella::match&) {});
+            for (std::size_t offset = 0; offset < text.size(); offset += chunk_size) {
+                bytes_parser.push_bytes(
+                    pontella::slice(text.data() + offset, std::min(chunk_size, text.size() - offset)));
+            }
+            bytes_parser.finish();
+            REQUIRE(pushed == expected);
+        }
+        {
+            std::ofstream("pontella_tokens.rsp") << text;
+            std::vector<const char*> arguments{"./program", "@pontella_tokens.rsp"};
+            pontella::response_file_tokens tokens(
+                static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+            std::vector<std::string> read;
+            pontella::slice token;
+            while (tokens.next(token)) {
+                read.push_back(token.to_string());
+            }
+            REQUIRE(read == expected);
+            std::remove("pontella_tokens.rsp");
+        }
+    }
+    {
+        std::vector<pontella::slice> tokens;
+        std::deque<std::string> storage;
+        pontella::slice unterminated;
+        REQUIRE(pontella::tokenize_line("a\"b\\\nc\"d x\\\ny", tokens, storage, unterminated));
+        REQUIRE(tokens.size() == 2);
+        REQUIRE(tokens[0].to_string() == "abcd");
+        REQUIRE(tokens[1].to_string() == "xy");
+        tokens.clear();
+        REQUIRE(pontella::tokenize_line("a \\\n    b \\", tokens, storage, unterminated));
+        REQUIRE(tokens.size() == 2);
+        REQUIRE(tokens[0].to_string() == "a");
+        REQUIRE(tokens[1].to_string() == "b");
+    }
+    {
+        std::ofstream("pontella_continuation.rsp") << "--level 3 \\\n    input.txt \\\n";
+        std::vector<const char*> arguments{"./program", "@pontella_continuation.rsp"};
+        pontella::response_file_tokens tokens(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+        const auto command = parser.parse(tokens);
+        REQUIRE(command.arguments == std::vector<std::string>({"input.txt"}));
+        REQUIRE(command.options.at("level") == "3");
+        std::remove("pontella_continuation.rsp");
+    }
+}
+
+TEST_CASE("Expand response files", "[response_file_tokens]") {
+    {
+        std::ofstream first("pontella_first.rsp");
+        first << "a.log --verbose 'two words' \"c\\\"d\" e\\ f\n\t@pontella_second.rsp\n";
+        std::ofstream second("pontella_second.rsp");
+        second << "-h   last.log";
+        std::ofstream recursive("pontella_recursive.rsp");
+        recursive << "@pontella_recursive.rsp";
+        std::ofstream unterminated("pontella_unterminated.rsp");
+        unterminated << "'a.log";
+    }
+    const pontella::parser parser(-1, {{"verbose", {"v"}}}, {{"help", {"h"}}});
+    {
+        std::vector<const char*> arguments{"./program", "@pontella_first.rsp", "z.log"};
+        pontella::response_file_tokens tokens(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+        const auto command = parser.parse(tokens);
+        REQUIRE(command.arguments == std::vector<std::string>({"a.log", "c\"d", "e f", "last.log", "z.log"}));
+        REQUIRE(command.options.at("verbose") == "two words");
+        REQUIRE(command.flags.find("help") != command.flags.end());
+    }
+    for (const auto& filename : {"@pontella_recursive.rsp", "@pontella_unterminated.rsp", "@pontella_missing.rsp"}) {
+        std::vector<const char*> arguments{"./program", filename};
+        pontella::response_file_tokens tokens(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+        REQUIRE_THROWS_AS(parser.parse(tokens), std::runtime_error);
+    }
+    {
+        std::vector<const char*> arguments{
+            "./program", "a.log", "@pontella_missing.rsp", "@pontella_unterminated.rsp", "@pontella_recursive.rsp"};
+        pontella::response_file_tokens tokens(
+            static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()), 2);
+        const auto outcome = parser.try_parse(tokens);
+        REQUIRE(outcome.result.arguments == std::vector<std::string>({"a.log"}));
+        REQUIRE(outcome.errors.size() == 3);
+        REQUIRE(outcome.errors[0].kind == pontella::error_kind::unreadable_response_file);
+        REQUIRE(outcome.errors[0].index == 2);
+        REQUIRE(outcome.errors[0].text.to_string() == "pontella_missing.rsp");
+        REQUIRE(outcome.errors[1].kind == pontella::error_kind::unterminated_quote);
+        REQUIRE(outcome.errors[1].text.to_string() == "'a.log");
+        REQUIRE(outcome.errors[2].kind == pontella::error_kind::nested_response_file);
+        REQUIRE(
+            pontella::describe(outcome.errors[0])
+            == "The response file 'pontella_missing.rsp' could not be read");
+    }
+    {
+        std::vector<const char*> arguments{"./program", "@pontella_second.rsp"};
+        REQUIRE(
+            parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data())).arguments.front()
+            == "@pontella_second.rsp");
+    }
+    for (const auto& filename :
+         {"pontella_first.rsp", "pontella_second.rsp", "pontella_recursive.rsp", "pontella_unterminated.rsp"}) {
+        std::remove(filename);
+    }
+}
+
+TEST_CASE("Parse a spool file in parallel", "[spool]") {
+    std::vector<pontella::slice> tokens;
+    std::deque<std::string> storage;
+    pontella::slice unterminated;
+    const std::string line(
+        "  plain-token-longer-than-sixteen 'single \"quoted\" \\n' \"double \\\"quoted\\\" \\$HOME \\x\"\tmixed\\ "
+        "word'quote'\"s\"  ");
+    REQUIRE(pontella::tokenize_line(line, tokens, storage, unterminated));
+    std::vector<std::string> strings;
+    for (const auto& token : tokens) {
+        strings.push_back(token.to_string());
+    }
+    REQUIRE(
+        strings
+        == (std::vector<std::string>{
+            "plain-token-longer-than-sixteen",
+            "single \"quoted\" \\n",
+            "double \"quoted\" $HOME \\x",
+            "mixed wordquotes"}));
+    REQUIRE(tokens.front().data == line.data() + 2);
+    REQUIRE(!pontella::tokenize_line("a \"b c", tokens, storage, unterminated));
+    REQUIRE(unterminated.to_string() == "\"b c");
+    {
+        std::ofstream spool_file("pontella.spool");
+        for (std::size_t index = 0; index < 5000; ++index) {
+            if (index % 1000 == 999) {
+                spool_file << "input-" << index << " --unknown\r\n";
+            } else if (index == 2500) {
+                spool_file << "'unterminated\n";
+            } else {
+                spool_file << "input-" << index << " -v \"level " << index % 3 << "\"\n";
+            }
+        }
+        spool_file << "last";
+    }
+    const pontella::parser parser(1, {{"verbose", {"v"}}}, {{"help", {"h"}}});
+    const pontella::spool spool(parser, "pontella.spool", 4, 64);
+    REQUIRE(spool.size() == 5001);
+    for (std::size_t index = 0; index < 5000; ++index) {
+        const auto& outcome = spool[index];
+        if (index % 1000 == 999) {
+            REQUIRE(outcome.errors.size() == 1);
+            REQUIRE(outcome.errors.front().kind == pontella::error_kind::unknown_name);
+            REQUIRE(outcome.errors.front().text.to_string() == "unknown");
+        } else if (index == 2500) {
+            REQUIRE(outcome.errors.size() == 1);
+            REQUIRE(pontella::describe(outcome.errors.front()) == "Unterminated quote in ''unterminated'");
+        } else {
+            REQUIRE(outcome);
+            REQUIRE(outcome.result.arguments.front() == "input-" + std::to_string(index));
+            REQUIRE(outcome.result.options.at("verbose") == "level " + std::to_string(index % 3));
+        }
+    }
+    REQUIRE(spool[5000].result.arguments.front() == "last");
+    std::remove("pontella.spool");
+    std::vector<uint8_t> visits(10000, 0);
+    pontella::parallel_for(visits.size(), 8, [&](std::size_t index) { ++visits[index]; });
+    REQUIRE(std::all_of(visits.begin(), visits.end(), [](uint8_t visit) { return visit == 1; }));
+    std::atomic<std::size_t> nested_visits(0);
+    std::atomic<std::size_t> foreign_threads(0);
+    pontella::parallel_for(4, 4, [&](std::size_t) {
+        const auto thread_id = std::this_thread::get_id();
+        pontella::parallel_for(8, 8, [&](std::size_t) {
+            ++nested_visits;
+            if (std::this_thread::get_id() != thread_id) {
+                ++foreign_threads;
+            }
+        });
+    });
+    REQUIRE(nested_visits == 32);
+    REQUIRE(foreign_threads == 0);
+    REQUIRE(!pontella::is_parallel_worker());
+}
+
+TEST_CASE("Collect the parameters of repeatable options", "[repeatable]") {
+    const pontella::parser parser(
+        -1, {{"input", {"i"}, true}, {"weight", {"w"}, true}, {"verbose", {"v"}}}, {{"help", {"h"}}});
+    std::vector<std::string> inputs;
+    for (std::size_t index = 0; index < 100000; ++index) {
+        inputs.push_back(std::to_string(index) + ".log");
+    }
+    std::vector<const char*> arguments{"./program", "-v", "1", "--verbose=2"};
+    for (std::size_t index = 0; index < inputs.size(); ++index) {
+        arguments.push_back("--input");
+        arguments.push_back(inputs[index].c_str());
+        if (index % 1000 == 0) {
+            arguments.push_back("-w=0.5");
+        }
+    }
+    const auto command_view =
+        parser.parse_view(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    const auto input = parser.id("input");
+    const auto weight = parser.id("weight");
+    REQUIRE(command_view.values_end(input) - command_view.values_begin(input) == 100000);
+    REQUIRE(command_view.values_end(weight) - command_view.values_begin(weight) == 100);
+    REQUIRE(command_view.values_begin(parser.id("verbose")) == command_view.values_end(parser.id("verbose")));
+    REQUIRE(command_view.options[parser.id("verbose")].to_string() == "1");
+    auto ordered = true;
+    for (std::size_t index = 0; index < inputs.size(); ++index) {
+        ordered &= command_view.values_begin(input)[index].data == inputs[index].c_str();
+    }
+    REQUIRE(ordered);
+    const auto command = parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    const auto command_inputs = command.repeated_values("input");
+    REQUIRE(command_inputs.size() == 100000);
+    REQUIRE(command_inputs[command_inputs.size() - 1].to_string() == inputs.back());
+    REQUIRE(command.repeated_values("weight").size() == 100);
+    REQUIRE(command.repeated_values("verbose").empty());
+    REQUIRE(command.repeated.size() == 2);
+    REQUIRE(command.repeated.count("verbose") == 0);
+    REQUIRE(command.options.at("input") == inputs.front());
+    ordered = true;
+    std::size_t index = 0;
+    for (const auto value : command_inputs) {
+        ordered &= value.to_string() == inputs[index];
+        ++index;
+    }
+    REQUIRE(ordered);
+    const auto copy = command_view.to_command();
+    REQUIRE(copy.repeated == command.repeated);
+    for (const auto name : {"input", "weight"}) {
+        REQUIRE(std::equal(
+            copy.repeated_values(name).begin(),
+            copy.repeated_values(name).end(),
+            command.repeated_values(name).begin(),
+            [](pontella::slice first, pontella::slice second) { return pontella::compare(first, second) == 0; }));
+    }
+    REQUIRE_THROWS_AS(pontella::parser(0, {}, {{"help", {"h"}, true}}), std::logic_error);
+}
+
+TEST_CASE("Convert typed parameters", "[parameter_type]") {
+    const pontella::parser parser(
+        0,
+        {{"verbose", {"v"}, pontella::integer(0, 3)},
+         {"rate", {}, pontella::floating(0.0, 1.0)},
+         {"mode", {}, pontella::enumeration({"fast", "slow"})},
+         {"timeout", {}, pontella::duration()},
+         {"ports", {}, pontella::integer_list(1, 65535)},
+         {"weights", {}, pontella::floating_list()},
+         {"name"}},
+        {{"help", {"h"}}});
+    std::string weights;
+    for (std::size_t index = 0; index < 20000; ++index) {
+        weights += (index == 0 ? "" : ",") + std::to_string(index) + ".25";
+    }
+    weights = "--weights=" + weights;
+    std::vector<const char*> arguments{
+        "./program", "-v", "2", "--rate=0.125", "--mode", "slow", "--timeout=1.5s", "--ports=80,443", weights.c_str()};
+    const auto command_view =
+        parser.parse_view(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    REQUIRE(command_view.integer(parser.id("verbose")) == 2);
+    REQUIRE(command_view.floating(parser.id("rate")) == 0.125);
+    REQUIRE(command_view.choice(parser.id("mode")) == 1);
+    REQUIRE(command_view.duration(parser.id("timeout")) == std::chrono::milliseconds(1500));
+    const auto ports = parser.id("ports");
+    REQUIRE(command_view.elements_end(ports) - command_view.elements_begin(ports) == 2);
+    REQUIRE(command_view.elements_begin(ports)[1].integer == 443);
+    const auto weights_id = parser.id("weights");
+    REQUIRE(command_view.elements_end(weights_id) - command_view.elements_begin(weights_id) == 20000);
+    REQUIRE(command_view.elements_begin(weights_id)[19999].floating == 19999.25);
+    const auto command = parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    REQUIRE(pontella::to_integer(command.options.at("verbose")) == 2);
+    REQUIRE(pontella::to_floating("-1.5e3") == -1500.0);
+    REQUIRE(pontella::to_floating("0.1") == 0.1);
+    REQUIRE(pontella::to_floating("1e-320") == 1e-320);
+    REQUIRE(pontella::to_floating("0.30000000000000004") == 0.30000000000000004);
+    REQUIRE(pontella::to_floating("1.7976931348623157e308") == std::numeric_limits<double>::max());
+    REQUIRE(pontella::to_floating("4.9406564584124654e-324") == std::numeric_limits<double>::denorm_min());
+    REQUIRE(pontella::to_floating("9007199254740993") == 9007199254740992.0);
+    REQUIRE(pontella::to_floating("0.1000000000000000055511151231257827021181583404541015625") == 0.1);
+    REQUIRE(pontella::to_floating("2.4703282292062327e-324") == 0.0);
+    REQUIRE(pontella::to_floating("2.4703282292062328e-324") == std::numeric_limits<double>::denorm_min());
+    REQUIRE(pontella::to_floating("9007199254740993.0000000000000000000001") == 9007199254740994.0);
+    REQUIRE(pontella::to_floating("0." + std::string(1000, '0') + "1e1000") == 0.1);
+    REQUIRE(pontella::to_floating("9007199254740993" + std::string(1000, '0') + "e-1000") == 9007199254740992.0);
+    REQUIRE(
+        pontella::to_floating("9007199254740993" + std::string(1000, '0') + "1e-1001") == 9007199254740994.0);
+    {
+        std::mt19937_64 engine(42);
+        std::size_t mismatches = 0;
+        for (std::size_t index = 0; index < 100000; ++index) {
+            const auto bits = engine();
+            double expected = 0.0;
+            std::memcpy(&expected, &bits, sizeof(expected));
+            if (!std::isfinite(expected)) {
+                continue;
+            }
+            char characters[32];
+            std::snprintf(characters, sizeof(characters), "%.17g", expected);
+            double value = 0.0;
+            if (!pontella::read_floating(characters, value) || std::memcmp(&value, &expected, sizeof(value)) != 0) {
+                ++mismatches;
+            }
+        }
+        REQUIRE(mismatches == 0);
+    }
+    REQUIRE(pontella::to_integer("-9223372036854775808") == std::numeric_limits<int64_t>::min());
+    REQUIRE(pontella::to_duration("250us") == std::chrono::microseconds(250));
+    REQUIRE_THROWS_AS(pontella::to_integer("9223372036854775808"), std::runtime_error);
+    REQUIRE_THROWS_AS(pontella::to_integer("12a"), std::runtime_error);
+    REQUIRE_THROWS_AS(pontella::to_floating("1e999"), std::runtime_error);
+    REQUIRE_THROWS_AS(pontella::to_duration("10"), std::runtime_error);
+    for (const auto invalid : {"--verbose=4", "--rate=2", "--mode=medium", "--timeout=-1s", "--ports=80,0", "-v="}) {
+        std::vector<const char*> invalid_arguments{"./program", invalid};
+        REQUIRE_THROWS_WITH(
+            parser.parse(static_cast<int>(invalid_arguments.size()), const_cast<char**>(invalid_arguments.data())),
+            Catch::Contains("expects"));
+        REQUIRE_THROWS_AS(
+            parser.parse_view(static_cast<int>(invalid_arguments.size()), const_cast<char**>(invalid_arguments.data())),
+            std::runtime_error);
+    }
+    REQUIRE_THROWS_AS(pontella::parser(0, {}, {{"help", {"h"}, pontella::integer()}}), std::logic_error);
+    REQUIRE_THROWS_AS(pontella::parser(0, {{"verbose", {}, pontella::integer(3, 0)}}, {}), std::logic_error);
+}
+
+TEST_CASE("Append the elements of repeatable list options", "[parameter_type]") {
+    const pontella::parser parser(
+        0,
+        {{"list", {"l"}, true, pontella::integer_list()},
+         {"other", {}, true, pontella::integer_list()},
+         {"weights", {}, pontella::floating_list()}},
+        {});
+    std::vector<const char*> arguments{
+        "./program", "--list=1,2", "--other=7", "--weights=0.5,1.5", "-l", "3,4,5", "--other=8,9", "--list="};
+    const auto command_view =
+        parser.parse_view(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    const auto list = parser.id("list");
+    REQUIRE(command_view.values_end(list) - command_view.values_begin(list) == 3);
+    std::vector<int64_t> elements;
+    for (auto element = command_view.elements_begin(list); element != command_view.elements_end(list); ++element) {
+        elements.push_back(element->integer);
+    }
+    REQUIRE(elements == std::vector<int64_t>({1, 2, 3, 4, 5}));
+    const auto other = parser.id("other");
+    REQUIRE(command_view.elements_end(other) - command_view.elements_begin(other) == 3);
+    REQUIRE(command_view.elements_begin(other)[0].integer == 7);
+    REQUIRE(command_view.elements_begin(other)[2].integer == 9);
+    const auto weights = parser.id("weights");
+    REQUIRE(command_view.elements_end(weights) - command_view.elements_begin(weights) == 2);
+    REQUIRE(command_view.elements_begin(weights)[1].floating == 1.5);
+    std::vector<const char*> invalid_arguments{"./program", "--list=1,2", "--other=7", "--list=3,x"};
+    REQUIRE_THROWS_WITH(
+        parser.parse_view(static_cast<int>(invalid_arguments.size()), const_cast<char**>(invalid_arguments.data())),
+        Catch::Contains("expects"));
+}
+
+TEST_CASE("Check path parameters and arguments concurrently", "[path]") {
+    std::vector<std::string> inputs;
+    for (std::size_t index = 0; index < 64; ++index) {
+        inputs.push_back("pontella-" + std::to_string(index) + ".input");
+        std::ofstream(inputs.back()) << index;
+    }
+    auto parser = pontella::parser(
+        -1,
+        {{"input", {"i"}, true, pontella::path(pontella::path_is_file | pontella::path_is_readable)},
+         {"output", {"o"}, pontella::path(pontella::path_parent_exists)}},
+        {{"help", {"h"}}});
+    parser.check_arguments(pontella::path(pontella::path_exists)).limit_path_threads(8);
+    std::vector<const char*> arguments{"./program", "--output=missing/output", inputs.front().c_str()};
+    for (const auto& input : inputs) {
+        arguments.push_back("-i");
+        arguments.push_back(input.c_str());
+    }
+    arguments.push_back("--input=missing.input");
+    arguments.push_back("missing.argument");
+    arguments.push_back("-o");
+    arguments.push_back("output");
+    {
+        const auto outcome =
+            parser.try_parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+        REQUIRE(outcome.errors.size() == 3);
+        REQUIRE(outcome.errors[0].kind == pontella::error_kind::invalid_parameter);
+        REQUIRE(outcome.errors[0].index == 1);
+        REQUIRE(
+            pontella::describe(outcome.errors[0])
+            == "The option 'output' expects a path in an existing directory (got 'missing/output')");
+        REQUIRE(outcome.errors[1].index == inputs.size() * 2 + 3);
+        REQUIRE(
+            pontella::describe(outcome.errors[1])
+            == "The option 'input' expects an existing readable regular file (got 'missing.input')");
+        REQUIRE(outcome.errors[2].kind == pontella::error_kind::invalid_argument);
+        REQUIRE(pontella::describe(outcome.errors[2]) == "The argument 'missing.argument' is not an existing path");
+        REQUIRE(outcome.result.repeated_values("input").size() == inputs.size() + 1);
+    }
+    REQUIRE_THROWS_WITH(
+        parser.parse_view(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data())),
+        "The option 'output' expects a path in an existing directory (got 'missing/output')\n"
+        "The option 'input' expects an existing readable regular file (got 'missing.input')\n"
+        "The argument 'missing.argument' is not an existing path");
+    arguments.resize(arguments.size() - 4);
+    arguments[1] = "--output=output";
+    const auto command = parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    REQUIRE(command.options.at("output") == "output");
+    const auto command_inputs = command.repeated_values("input");
+    REQUIRE(command_inputs[command_inputs.size() - 1].to_string() == inputs.back());
+    REQUIRE(pontella::parent_path("directory/file") == "directory");
+    REQUIRE(pontella::parent_path("/file") == "/");
+    REQUIRE(pontella::parent_path("file") == ".");
+#if defined(PONTELLA_MMAP) || defined(_WIN32)
+    REQUIRE(pontella::check_path(pontella::path(pontella::path_is_directory), "."));
+    REQUIRE(!pontella::check_path(pontella::path(pontella::path_is_directory), inputs.front()));
+    REQUIRE(!pontella::check_path(pontella::path(pontella::path_is_file), "."));
+#endif
+    REQUIRE(pontella::check_path(pontella::path(), "missing.input"));
+    REQUIRE(pontella::check_path(pontella::path(pontella::path_parent_exists), "output"));
+    for (const auto& input : inputs) {
+        std::remove(input.c_str());
+    }
+    REQUIRE_THROWS_AS(parser.check_arguments(pontella::integer()), std::logic_error);
+}
+
+TEST_CASE("Collect every error without throwing", "[try_parse]") {
+    const pontella::parser parser(
+        1, {{"verbose", {"v"}, pontella::integer(0, 3)}, {"output", {"o"}}}, {{"help", {"h"}}});
+    std::vector<const char*> arguments{
+        "./program", "-", "--unknown", "-v", "7", "--help=1", "first", "second", "--output"};
+    const auto outcome = parser.try_parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    REQUIRE(!outcome);
+    REQUIRE(outcome.errors.size() == 6);
+    REQUIRE(outcome.errors[0].kind == pontella::error_kind::missing_name);
+    REQUIRE(outcome.errors[0].index == 1);
+    REQUIRE(outcome.errors[1].kind == pontella::error_kind::unknown_name);
+    REQUIRE(outcome.errors[1].text.to_string() == "unknown");
+    REQUIRE(outcome.errors[2].kind == pontella::error_kind::invalid_parameter);
+    REQUIRE(outcome.errors[2].index == 4);
+    REQUIRE(
+        pontella::describe(outcome.errors[2])
+        == "The option 'verbose' expects an integer in the range [0, 3] (got '7')");
+    REQUIRE(outcome.errors[3].kind == pontella::error_kind::unexpected_parameter);
+    REQUIRE(outcome.errors[4].kind == pontella::error_kind::too_many_arguments);
+    REQUIRE(outcome.errors[4].index == 7);
+    REQUIRE(outcome.errors[5].kind == pontella::error_kind::missing_parameter);
+    REQUIRE(outcome.result.arguments == std::vector<std::string>({"first"}));
+    REQUIRE_THROWS_WITH(
+        parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data())),
+        pontella::describe(outcome.errors[0]));
+    const auto view_outcome =
+        parser.try_parse_view(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    REQUIRE(view_outcome.errors.size() == 6);
+    {
+        std::vector<const char*> valid_arguments{"./program", "-v", "2", "input"};
+        const auto valid_outcome =
+            parser.try_parse_view(static_cast<int>(valid_arguments.size()), const_cast<char**>(valid_arguments.data()));
+        REQUIRE(valid_outcome);
+        REQUIRE(valid_outcome.result.integer(parser.id("verbose")) == 2);
+    }
+    {
+        std::vector<const char*> missing_arguments{"./program"};
+        const auto missing_outcome =
+            parser.try_parse(static_cast<int>(missing_arguments.size()), const_cast<char**>(missing_arguments.data()));
+        REQUIRE(missing_outcome.errors.size() == 1);
+        REQUIRE(missing_outcome.errors[0].kind == pontella::error_kind::not_enough_arguments);
+        REQUIRE(missing_outcome.errors[0].index == 1);
+    }
+}
+
+TEST_CASE("Dispatch nested subcommands", "[command_tree]") {
+    std::size_t number_of_schemas = 0;
+    std::string handled;
+    pontella::command_tree tree([&]() {
+        ++number_of_schemas;
+        return pontella::schema{0, {{"directory", {"C"}}}, {{"verbose", {"v"}}}};
+    });
+    auto& remote = tree.add("remote", [&]() {
+        ++number_of_schemas;
+        return pontella::schema{0, {}, {}};
+    });
+    remote.add(
+        "add",
+        [&]() {
+            ++number_of_schemas;
+            return pontella::schema{2, {{"fetch", {"f"}}}, {}};
+        },
+        [&](const pontella::routed_command& routed_command) { handled = routed_command.command.arguments.front(); });
+    for (std::size_t index = 0; index < 200; ++index) {
+        tree.add("command" + std::to_string(index), [&, index]() {
+            ++number_of_schemas;
+            return pontella::schema{-1, {{"option" + std::to_string(index)}}, {}};
+        });
+    }
+    std::vector<const char*> arguments{
+        "./program", "-C", "remote", "remote", "add", "--fetch=yes", "origin", "-v", "url"};
+    const auto routed_command = tree.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+    REQUIRE(routed_command.path == std::vector<std::string>({"remote", "add"}));
+    REQUIRE(routed_command.command.arguments == std::vector<std::string>({"origin", "url"}));
+    REQUIRE(routed_command.command.options.at("directory") == "remote");
+    REQUIRE(routed_command.command.options.at("fetch") == "yes");
+    REQUIRE(routed_command.command.flags.count("verbose") == 1);
+    REQUIRE(number_of_schemas == 3);
+    REQUIRE(!tree.subcommand("command7")->is_materialized());
+    REQUIRE(
+        pontella::main({}, static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()), tree) == 0);
+    REQUIRE(handled == "origin");
+    {
+        std::vector<const char*> invalid_arguments{"./program", "bogus", "-v"};
+        REQUIRE_THROWS_WITH(
+            tree.parse(static_cast<int>(invalid_arguments.size()), const_cast<char**>(invalid_arguments.data())),
+            "Unknown subcommand 'bogus'");
+    }
+    {
+        std::vector<const char*> invalid_arguments{"./program", "remote", "add", "origin"};
+        const auto outcome =
+            tree.try_parse(static_cast<int>(invalid_arguments.size()), const_cast<char**>(invalid_arguments.data()));
+        REQUIRE(outcome.errors.size() == 1);
+        REQUIRE(outcome.errors[0].kind == pontella::error_kind::not_enough_arguments);
+        REQUIRE(outcome.errors[0].index == 4);
+    }
+    {
+        std::vector<const char*> help_arguments{"./program", "remote", "add", "-h", "origin", "url"};
+        handled.clear();
+        REQUIRE(
+            tree.parse(static_cast<int>(help_arguments.size()), const_cast<char**>(help_arguments.data()))
+                .command.flags.count("help")
+            == 1);
+        REQUIRE(
+            pontella::main({}, static_cast<int>(help_arguments.size()), const_cast<char**>(help_arguments.data()), tree)
+            == 1);
+        REQUIRE(handled.empty());
+    }
+    {
+        auto connected = false;
+        pontella::command_tree host_tree([]() { return pontella::schema{0, {}, {}}; });
+        auto& connect = host_tree.add(
+            "connect",
+            []() { return pontella::schema{0, {{"host", {"h"}}}, {}}; },
+            [&](const pontella::routed_command&) { connected = true; });
+        connect.add("tunnel", []() { return pontella::schema{0, {}, {}}; });
+        host_tree.add("status", []() { return pontella::schema{0, {}, {}}; });
+        host_tree.add("manual", []() { return pontella::schema{0, {}, {{"help", {"m"}}}}; });
+        std::vector<const char*> host_arguments{"./program", "connect", "-h", "example.com"};
+        const auto routed_command =
+            host_tree.parse(static_cast<int>(host_arguments.size()), const_cast<char**>(host_arguments.data()));
+        REQUIRE(routed_command.command.options.at("host") == "example.com");
+        REQUIRE(
+            pontella::main(
+                {}, static_cast<int>(host_arguments.size()), const_cast<char**>(host_arguments.data()), host_tree)
+            == 0);
+        REQUIRE(connected);
+        for (const auto& path : std::vector<std::vector<const char*>>{
+                 {"./program", "connect", "--help"},
+                 {"./program", "connect", "tunnel", "--help"},
+                 {"./program", "status", "-h"},
+                 {"./program", "-h"},
+                 {"./program", "manual", "-m"}}) {
+            REQUIRE(
+                host_tree.parse(static_cast<int>(path.size()), const_cast<char**>(path.data()))
+                    .command.flags.count("help")
+                == 1);
+        }
+        std::vector<const char*> tunnel_arguments{"./program", "connect", "tunnel", "-h"};
+        REQUIRE_THROWS_WITH(
+            host_tree.parse(static_cast<int>(tunnel_arguments.size()), const_cast<char**>(tunnel_arguments.data())),
+            "The option 'host' requires a parameter");
+        std::vector<const char*> manual_arguments{"./program", "manual", "-h"};
+        REQUIRE_THROWS_AS(
+            host_tree.parse(static_cast<int>(manual_arguments.size()), const_cast<char**>(manual_arguments.data())),
+            std::runtime_error);
+    }
+    REQUIRE_THROWS_AS(tree.add("-remote", []() { return pontella::schema{0, {}, {}}; }), std::logic_error);
+    REQUIRE_THROWS_AS(tree.add("remote", []() { return pontella::schema{0, {}, {}}; }), std::logic_error);
+}
+
+constexpr pontella::static_label static_labels[] = {
+    pontella::static_option("verbose", "v verb"),
+    pontella::static_flag("help", "h"),
+};
+constexpr auto static_parser = pontella::make_static_parser(static_labels, 1);
+
+TEST_CASE("Parse a command line with a static parser", "[static_parser]") {
+    for (const auto& option : {"--verbose", "-v", "--verb"}) {
+        std::vector<const char*> arguments{"./program", option, "1", "input.log", "-h"};
+        const auto command =
+            static_parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+        REQUIRE(command.arguments.size() == 1);
+        REQUIRE(command.arguments.front() == "input.log");
+        REQUIRE(command.options.at("verbose") == "1");
+        REQUIRE(command.flags.find("help") != command.flags.end());
+        const auto command_view =
+            static_parser.parse_view(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+        REQUIRE(command_view.options[0].data == arguments[2]);
+        REQUIRE(command_view.flags[1]);
+        REQUIRE(command_view.to_command().options.at("verbose") == "1");
+    }
+    for (const auto& option : {"--ver", "--verbo", "-hv", "--v=1=2"}) {
+        std::vector<const char*> arguments{"./program", option, "input.log"};
+        if (std::string(option) == "--v=1=2") {
+            const auto command =
+                static_parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()));
+            REQUIRE(command.options.at("verbose") == "1=2");
+        } else {
+            REQUIRE_THROWS_AS(
+                static_parser.parse(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data())),
+                std::runtime_error);
+        }
+    }
+}
+
+#define PONTELLA_LABEL(index) pontella::static_option("option" #index, "o" #index)
+#define PONTELLA_LABELS_4(index) \
+    PONTELLA_LABEL(index##0), PONTELLA_LABEL(index##1), PONTELLA_LABEL(index##2), PONTELLA_LABEL(index##3)
+#define PONTELLA_LABELS_16(index) \
+    PONTELLA_LABELS_4(index##0), PONTELLA_LABELS_4(index##1), PONTELLA_LABELS_4(index##2), PONTELLA_LABELS_4(index##3)
+#define PONTELLA_LABELS_64(index) \
+    PONTELLA_LABELS_16(index##0), PONTELLA_LABELS_16(index##1), PONTELLA_LABELS_16(index##2), \
+        PONTELLA_LABELS_16(index##3)
+constexpr pontella::static_label many_static_labels[] = {
+    PONTELLA_LABELS_64(0),
+    PONTELLA_LABELS_64(1),
+    PONTELLA_LABELS_64(2),
+    PONTELLA_LABELS_64(3),
+};
+constexpr auto many_static_parser = pontella::make_static_parser(many_static_labels, -1);
+
+TEST_CASE("Find names and aliases in a large static parser", "[static_parser]") {
+    auto found = true;
+    for (std::size_t id = 0; id < many_static_parser.size(); ++id) {
+        std::string suffix;
+        for (auto rest = id; suffix.size() < 4; rest /= 4) {
+            suffix.insert(suffix.begin(), static_cast<char>('0' + rest % 4));
+        }
+        pontella::match match;
+        for (const auto& name_or_alias : {"option" + suffix, "o" + suffix}) {
+            found &= many_static_parser.find(name_or_alias, match) && match.id == id && match.is_option;
+        }
+        found &= !many_static_parser.find("option" + suffix.substr(1), match);
+    }
+    REQUIRE(found);
+    pontella::match match;
+    REQUIRE(!many_static_parser.find("o", match));
+    REQUIRE(!many_static_parser.find("p", match));
+    REQUIRE(!many_static_parser.find("", match));
+}
+
+TEST_CASE("Fail on static labels with the same alias", "[static_parser]") {
+    const pontella::static_label labels[] = {
+        pontella::static_option("hidden", "x h"),
+        pontella::static_flag("help", "h"),
+    };
+    REQUIRE_THROWS_AS(pontella::make_static_parser(labels, 0), std::logic_error);
+    const pontella::static_label many_aliases[] = {pontella::static_flag("help", "a b c d")};
+    REQUIRE_THROWS_AS(pontella::make_static_parser(many_aliases, 0), std::logic_error);
+    REQUIRE(pontella::make_static_parser<4>(many_aliases, 0).size() == 1);
+    REQUIRE_THROWS_AS(pontella::static_flag("help", "h "), std::logic_error);
+    REQUIRE_THROWS_AS(pontella::static_flag("-help"), std::logic_error);
+    REQUIRE_THROWS_AS(pontella::static_flag("he=lp"), std::logic_error);
+}
+
 TEST_CASE("Test a command line for a flag", "[test]") {
     for (const auto& option : {"--help", "-help", "--h", "-h"}) {
         std::vector<const char*> arguments{"./program", option};
@@ -177,6 +1196,29 @@ TEST_CASE("Test a command line for a flag", "[test]") {
     }
 }
 
+TEST_CASE("Test a command line for several flags", "[test]") {
+    std::vector<const char*> arguments{"./program", "input", "-v", "--output=file", "--quiet", "--", "--help"};
+    const auto present = pontella::test_flags(
+        static_cast<int>(arguments.size()),
+        const_cast<char**>(arguments.data()),
+        {{"help", {"h"}}, {"verbose", {"v"}}, {"quiet"}, {"output", {"o"}}});
+    REQUIRE(present == std::vector<bool>({false, true, true, false}));
+    REQUIRE(!pontella::test(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()), {"help"}));
+    const std::vector<pontella::label> flags{{"quiet", {"q"}}, {"verbose", {"v"}}};
+    bool flags_present[] = {false, false};
+    pontella::test_flags(
+        static_cast<int>(arguments.size()),
+        const_cast<char**>(arguments.data()),
+        flags.begin(),
+        flags.end(),
+        flags_present);
+    REQUIRE(flags_present[0]);
+    REQUIRE(flags_present[1]);
+    REQUIRE_THROWS_AS(
+        pontella::test(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data()), {"-help"}),
+        std::logic_error);
+}
+
 TEST_CASE("Test the main wrapper", "[main]") {
     {
         std::vector<const char*> arguments{"./program"};